@@ -0,0 +1,98 @@
+// MDTools
+//     Copyright (C)  2025  Pablo Galaviz
+//
+//     This program is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+//
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+//
+//     You should have received a copy of the GNU General Public License
+//     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//
+// Created by Pablo Galaviz on 16/10/2026.
+//
+
+#ifndef MDTOOLS_ATOMSELECTION_H
+#define MDTOOLS_ATOMSELECTION_H
+
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+#include "parameters.h"
+
+namespace mdtools {
+
+    struct frame;
+
+    /**
+     * Atoms kept by the trajectory readers, given by io.atom_types, io.atom_indices and io.index_group.
+     * Atoms are identified by their 1-based index (lammps id, or the order of the gro/XDATCAR/trr/xtc file).
+     * Every given criterion has to hold, with none of them every atom is kept.
+     *
+     * The selection is resolved once the atom types are known (e.g. from the first frame), after that the
+     * selected atoms are stored in consecutive slots of every frame, in index order.
+     */
+    class atomSelection {
+
+        std::vector<std::pair<long, long>> types;
+        std::vector<std::pair<long, long>> ranges;
+        std::vector<long> group;
+        bool has_group = false;
+        // Slot of every atom (0-based index), -1 when it is not selected. Empty until resolved.
+        std::vector<int> slots;
+        // 0-based index of the atom in every slot.
+        std::vector<int> indices;
+
+    public:
+        atomSelection() = default;
+
+        explicit atomSelection(const io_options_t &io_options);
+
+        /// True when there is no criterion, i.e. every atom is kept.
+        bool all() const { return types.empty() && ranges.empty() && !has_group; }
+
+        /// True when the readers have to store selected atoms only.
+        bool active() const { return !all() && !slots.empty(); }
+
+        /// Whether the atom with 1-based index and type is selected.
+        bool contains(long index, int type) const;
+
+        /// Fix the selected atoms from the type of every atom in the file.
+        template<class C>
+        void resolve(const C &atom_type) {
+            slots.assign(std::size(atom_type), -1);
+            indices.clear();
+            for (size_t i = 0; i < slots.size(); i++) {
+                if (contains(static_cast<long>(i) + 1, atom_type[i])) {
+                    slots[i] = static_cast<int>(indices.size());
+                    indices.push_back(static_cast<int>(i));
+                }
+            }
+        }
+
+        /// Slot of the atom with 0-based index, or -1 when it is not selected. Every atom has its own slot when inactive.
+        long slot(long index) const {
+            if (!active()) { return index; }
+            return index >= 0 && index < static_cast<long>(slots.size()) ? slots[index] : -1;
+        }
+
+        /// 0-based index of the atom stored in slot.
+        size_t index(size_t slot) const { return active() ? indices[slot] : slot; }
+
+        /// Number of atoms stored out of the number_of_atoms of the file.
+        size_t size(size_t number_of_atoms) const { return active() ? indices.size() : number_of_atoms; }
+
+        /// Move the selected atoms of a frame with every atom of the file to their slots.
+        void compact(frame &current) const;
+    };
+
+}
+
+#endif //MDTOOLS_ATOMSELECTION_H
@@ -0,0 +1,91 @@
+// MDTools
+//     Copyright (C)  2025  Pablo Galaviz
+//
+//     This program is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+//
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+//
+//     You should have received a copy of the GNU General Public License
+//     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//
+// Created by Pablo Galaviz on 16/10/2026.
+//
+
+#ifndef MDTOOLS_BGZF_H
+#define MDTOOLS_BGZF_H
+
+#include <istream>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include "mappedFile.h"
+
+namespace mdtools {
+
+    /**
+     * Blocked gzip (BGZF, as written by bgzip) is a sequence of independent gzip members of at most
+     * 64 KiB, each one storing its compressed size in the "BC" extra field. The block table is
+     * recovered from these headers without inflating, so blocks can be inflated concurrently.
+     * BGZF files are valid gzip files and can still be read by any gzip decoder.
+     */
+
+    /// Maximum number of uncompressed bytes per block, same as bgzip.
+    constexpr size_t bgzf_block_data_size = 0xff00;
+
+    /// True if the file starts with a BGZF block header.
+    bool is_bgzf(const std::string &file_name);
+
+    /**
+     * Whole BGZF file inflated in parallel (OpenMP) into an anonymous memory mapping.
+     */
+    class bgzfFile : public mappedFile {
+
+    public:
+
+        explicit bgzfFile(const std::string &file_name);
+
+    };
+
+    /**
+     * BGZF file read as a stream: whenever the buffer is exhausted the next batch of blocks is inflated in
+     * parallel (OpenMP), so only one batch is held in memory whatever the size of the file.
+     * An invalid or corrupted block throws std::runtime_error, set badbit in the exceptions of the stream to
+     * receive it.
+     */
+    class bgzfStreambuf : public std::streambuf {
+
+        std::string file_name;
+        mappedFile compressed;
+        // Offset of the next block in the compressed file, and of the first page not given back yet.
+        size_t position = 0;
+        size_t released = 0;
+        size_t batch_blocks;
+        std::vector<char> buffer;
+
+    protected:
+
+        int_type underflow() override;
+
+    public:
+
+        explicit bgzfStreambuf(const std::string &file_name);
+
+    };
+
+    /**
+     * Compress input into BGZF blocks, compressing a batch of blocks per OpenMP thread at a time.
+     * @return number of uncompressed bytes written.
+     */
+    size_t bgzf_compress(std::istream &input, std::ostream &output, int level);
+
+}
+
+#endif //MDTOOLS_BGZF_H
@@ -0,0 +1,75 @@
+// MDTools
+//     Copyright (C)  2025  Pablo Galaviz
+//
+//     This program is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+//
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+//
+//     You should have received a copy of the GNU General Public License
+//     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//
+// Created by Pablo Galaviz on 16/10/2026.
+//
+
+#ifndef MDTOOLS_FRAMEINDEX_H
+#define MDTOOLS_FRAMEINDEX_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mdtools {
+
+    /// Location of one frame inside a trajectory file.
+    struct frame_index_entry_t {
+        uint64_t offset = 0;
+        int64_t time_step_id = 0;
+        int64_t number_of_atoms = 0;
+    };
+
+    /**
+     * Frame offsets of a trajectory file, persisted in a "<trajectory>.idx" sidecar.
+     * The sidecar stores the size and modification time of the trajectory and is
+     * ignored when they do not match, e.g. after the trajectory was appended to.
+     */
+    class frameIndex {
+
+        std::string trajectory_file_name;
+        uint64_t file_size = 0;
+        int64_t file_mtime = 0;
+
+    public:
+
+        std::vector<frame_index_entry_t> frames;
+
+        explicit frameIndex(const std::string &trajectory_file_name);
+
+        /**
+         * Load the sidecar. Returns false if it is missing, invalid or does not belong to the current trajectory.
+         * @param data_size bytes of the indexed data (inflated, for a compressed trajectory), every offset is below.
+         */
+        bool load(uint64_t data_size);
+
+        /// Write the sidecar, a failure (e.g. read only directory) is only reported.
+        void save() const;
+
+        std::string sidecar() const { return trajectory_file_name + ".idx"; }
+
+        bool empty() const { return frames.empty(); }
+
+        size_t size() const { return frames.size(); }
+
+        const frame_index_entry_t &operator[](size_t i) const { return frames[i]; }
+
+    };
+
+}
+
+#endif //MDTOOLS_FRAMEINDEX_H
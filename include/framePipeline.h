@@ -0,0 +1,80 @@
+// MDTools
+//     Copyright (C)  2025  Pablo Galaviz
+//
+//     This program is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+//
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+//
+//     You should have received a copy of the GNU General Public License
+//     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//
+// Created by Pablo Galaviz on 16/10/2026.
+//
+
+#ifndef MDTOOLS_FRAMEPIPELINE_H
+#define MDTOOLS_FRAMEPIPELINE_H
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "trajectoryReader.h"
+
+namespace mdtools {
+
+    /**
+     * Streams the frames of a trajectoryReader through a reader thread, which decodes them ahead into a bounded
+     * ring of frame buffers while the caller analyses the previous ones (io.prefetch_frames).
+     * The reader thread waits while the ring is full. Buffers are swapped in and out of the ring, so after the
+     * first round no frame is allocated or copied. With an empty ring the frames are read on the calling thread.
+     */
+    class framePipeline {
+
+        trajectoryReader &reader;
+        std::vector<frame> ring;
+        // The decoded frames are ring[head], ..., ring[head + count - 1] (modulo the ring size).
+        size_t head = 0;
+        size_t count = 0;
+        bool finished = false;
+        bool stopping = false;
+        // Thrown by the reader on the reader thread, rethrown by next() once the frames before it are consumed.
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable frame_ready;
+        std::condition_variable slot_free;
+        std::thread producer;
+
+        void produce();
+
+    public:
+        framePipeline(trajectoryReader &reader, size_t number_of_buffers);
+
+        framePipeline(const framePipeline &) = delete;
+
+        framePipeline &operator=(const framePipeline &) = delete;
+
+        ~framePipeline();
+
+        /// Start reading the frames start_iteration + k*delta_iteration (< end_iteration if positive).
+        void begin(int start_iteration, int delta_iteration, int end_iteration);
+
+        /**
+         * Move the next frame into current, current's buffers are given back to the reader thread.
+         * An exception thrown by the reader is rethrown here, on the calling thread.
+         * @return false when the trajectory is exhausted.
+         */
+        bool next(frame &current);
+
+    };
+
+} // mdtools
+
+#endif //MDTOOLS_FRAMEPIPELINE_H
@@ -23,9 +23,13 @@
 
 #include <boost/program_options.hpp>
 #include <boost/program_options/variables_map.hpp>
+#include <boost/algorithm/string.hpp>
 
 #include "logger.h"
+#include <algorithm>
 #include <chrono>
+#include <cstring>
+#include <glob.h>
 
 namespace mdtools {
     inline void create_output_directory(std::string path, bool backup) {
@@ -89,6 +93,41 @@ namespace mdtools {
         return ifs;
     }
 
+    /**
+     * Expand a comma separated list of file names or glob patterns, e.g. "dump.*.lammpstrj.gz".
+     * The matches of each pattern are in version order (part2 before part10), a pattern without
+     * matches is kept as it is so that opening it reports the missing file.
+     */
+    inline std::vector<std::string> list_input_files(const std::string &input) {
+        std::vector<std::string> patterns;
+        boost::algorithm::split(patterns, input, boost::is_any_of(","));
+        std::vector<std::string> result;
+        for (auto &pattern: patterns) {
+            boost::algorithm::trim(pattern);
+            if (pattern.empty()) {
+                continue;
+            }
+            glob_t matches;
+            if (glob(pattern.c_str(), GLOB_NOSORT | GLOB_NOCHECK, nullptr, &matches) != 0) {
+                result.push_back(pattern);
+                continue;
+            }
+            std::vector<std::string> files(matches.gl_pathv, matches.gl_pathv + matches.gl_pathc);
+            globfree(&matches);
+            std::sort(files.begin(), files.end(), [](const std::string &a, const std::string &b) {
+                return strverscmp(a.c_str(), b.c_str()) < 0;
+            });
+            result.insert(result.end(), files.begin(), files.end());
+        }
+        return result;
+    }
+
+    /// Parse a comma separated list of numbers and inclusive ranges, e.g. "1-100,250". Throws on syntax errors.
+    std::vector<std::pair<long, long>> parse_ranges(const std::string &input);
+
+    /// Read the atom indices (1-based) of group from a gromacs index file (.ndx). Throws if there is no such group.
+    std::vector<long> read_index_group(const std::string &file_name, const std::string &group);
+
     void show_options(boost::program_options::variables_map vm);
 
     void initialize(const std::string &code_name);
@@ -0,0 +1,158 @@
+// MDTools
+//     Copyright (C)  2025  Pablo Galaviz
+//
+//     This program is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+//
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+//
+//     You should have received a copy of the GNU General Public License
+//     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//
+// Created by Pablo Galaviz on 16/10/2026.
+//
+
+#ifndef MDTOOLS_LAMMPSPARSER_H
+#define MDTOOLS_LAMMPSPARSER_H
+
+#include <charconv>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "frameIndex.h"
+#include "trajectoryReader.h"
+
+namespace mdtools {
+
+    /**
+     * Tokenizer for lammps text dumps held in memory (e.g. a mapped file).
+     * All routines work on a [position, end) byte range and never allocate.
+     */
+
+    /// Returns the beginning of the line after position.
+    inline const char *next_line(const char *position, const char *end) {
+        auto line_end = static_cast<const char *>(memchr(position, '\n', end - position));
+        return line_end ? line_end + 1 : end;
+    }
+
+    /// Returns the line [position, line_end) without its end of line characters.
+    inline std::string_view line_view(const char *position, const char *line_end) {
+        while (line_end > position && (line_end[-1] == '\n' || line_end[-1] == '\r')) { line_end--; }
+        return {position, static_cast<size_t>(line_end - position)};
+    }
+
+    /// Parse an integer or floating point number after optional blanks. Returns nullptr on failure.
+    template<class T>
+    inline const char *parse_number(const char *position, const char *end, T &value) {
+        while (position < end && (*position == ' ' || *position == '\t')) { position++; }
+        auto result = std::from_chars(position, end, value);
+        return result.ec == std::errc() ? result.ptr : nullptr;
+    }
+
+    /// Returns the position after the next blank separated token, or nullptr if there is none.
+    inline const char *skip_token(const char *position, const char *end) {
+        while (position < end && (*position == ' ' || *position == '\t')) { position++; }
+        auto token = position;
+        while (position < end && *position != ' ' && *position != '\t' && *position != '\n' && *position != '\r') {
+            position++;
+        }
+        return position > token ? position : nullptr;
+    }
+
+    /// Value read from a column of the "ITEM: ATOMS" lines, X to VZ are stored in that order.
+    enum class lammps_column_t : uint8_t {
+        SKIP, ID, TYPE, X, Y, Z, VX, VY, VZ
+    };
+
+    /**
+     * Column layout of the atom lines, from the "ITEM: ATOMS id type ..." header. Positions are taken from
+     * xu yu zu, xsu ysu zsu, xs ys zs or x y z (in that order of preference), velocities from vx vy vz.
+     * A header without column names is read as "id type xs ys zs".
+     */
+    struct lammps_columns_t {
+        // Role of every column up to the last one used.
+        std::vector<lammps_column_t> roles = {lammps_column_t::ID, lammps_column_t::TYPE, lammps_column_t::X,
+                                              lammps_column_t::Y, lammps_column_t::Z};
+        // Positions are fractions of the box (xs, xsu).
+        bool scaled = true;
+        // Positions are continuous across the periodic boundaries (xu, xsu).
+        bool unwrapped = false;
+        bool velocities = false;
+        // Conversion of the dumped velocities to nm/fs, 0.1 for real units (Angstrom/fs).
+        double velocity_scale = 0.1;
+        bool resolved = false;
+    };
+
+    /// Conversion of lammps velocities to nm/fs: Angstrom/fs for real units, Angstrom/ps for metal units.
+    inline double lammps_velocity_scale(const std::string &units) { return units == "metal" ? 1e-4 : 0.1; }
+
+    /// Set the column layout from the "ITEM: ATOMS" header line. Returns false if it has no id column.
+    bool parse_lammps_columns(std::string_view header, lammps_columns_t &columns);
+
+    /// Column layout of the first "ITEM: ATOMS" header in [position, end), the default one if there is none.
+    lammps_columns_t find_lammps_columns(const char *position, const char *end);
+
+    /**
+     * Store the atom line [position, line_end) in its slot of current, with the layout of columns.
+     * The line of an unselected atom is not converted after its id.
+     * @return false if the line is invalid or the atom id is out of range.
+     */
+    bool parse_lammps_atom(const char *position, const char *line_end, const lammps_columns_t &columns,
+                           frame &current, int number_of_atoms, const atomSelection *selection);
+
+    /**
+     * What the parser found in a frame besides its atoms. The frames are parsed on worker threads, which
+     * do no I/O: the caller reports the status with report_frame_status once the frame is parsed.
+     */
+    struct frame_status_t {
+        // The number of atoms of the frame (found_atoms) differs from the expected one.
+        bool inconsistent = false;
+        int found_atoms = 0;
+        // Items that are not read (e.g. ITEM: TIME) and atom lines that could not be stored.
+        std::vector<std::string_view> unknown_items;
+        std::vector<std::string_view> invalid_lines;
+
+        void clear() {
+            inconsistent = false;
+            unknown_items.clear();
+            invalid_lines.clear();
+        }
+    };
+
+    /**
+     * Log the status of the frame time_step_id.
+     * @return false if its number of atoms is not the expected number_of_atoms.
+     */
+    bool report_frame_status(const frame_status_t &status, int time_step_id, int number_of_atoms);
+
+    /// Returns the beginning of the next line starting with item, or end if there is none.
+    const char *find_lammps_item(const char *position, const char *end, std::string_view item);
+
+    /// Returns the beginning of every "ITEM: TIMESTEP" line in [position, end).
+    std::vector<const char *> find_lammps_frames(const char *position, const char *end);
+
+    /// Returns the offset, time step and number of atoms of every frame in [begin, end).
+    std::vector<frame_index_entry_t> index_lammps_frames(const char *begin, const char *end);
+
+    /**
+     * Parse (or skip) the lammps frame starting at the next "ITEM: TIMESTEP" line.
+     * @param number_of_atoms expected number of atoms, set from the first frame when zero.
+     * @param columns layout of the atom lines.
+     * @param status what was found besides the atoms, to be reported by the caller.
+     * @param selection when given, only the selected atoms are converted and stored in their slots.
+     * @return the position after the frame or nullptr if there is no complete frame.
+     */
+    const char *parse_lammps_frame(const char *position, const char *end, frame &current, int &number_of_atoms,
+                                   bool skip, const lammps_columns_t &columns, frame_status_t &status,
+                                   const atomSelection *selection = nullptr);
+
+}
+
+#endif //MDTOOLS_LAMMPSPARSER_H
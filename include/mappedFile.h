@@ -0,0 +1,113 @@
+// MDTools
+//     Copyright (C)  2025  Pablo Galaviz
+//
+//     This program is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+//
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+//
+//     You should have received a copy of the GNU General Public License
+//     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//
+// Created by Pablo Galaviz on 16/10/2026.
+//
+
+#ifndef MDTOOLS_MAPPEDFILE_H
+#define MDTOOLS_MAPPEDFILE_H
+
+#include <algorithm>
+#include <string>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "logger.h"
+
+namespace mdtools {
+
+    /**
+     * Read-only memory mapping of a whole file.
+     */
+    class mappedFile {
+
+    protected:
+
+        int descriptor = -1;
+        char *data = nullptr;
+        size_t size = 0;
+
+        mappedFile() = default;
+
+        /// Anonymous mapping of length bytes, to be filled by a derived class.
+        void allocate(size_t length) {
+            size = length;
+            if (size > 0) {
+                void *address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (address == MAP_FAILED) {
+                    LOGGER.error << "Cannot allocate " << size << " bytes" << std::endl;
+                    exit(ENOMEM);
+                }
+                data = static_cast<char *>(address);
+            }
+        }
+
+    public:
+
+        explicit mappedFile(const std::string &file_name) {
+            descriptor = open(file_name.c_str(), O_RDONLY);
+            if (descriptor < 0) {
+                LOGGER.error << "No such file or directory: " << file_name << std::endl;
+                exit(ENOENT);
+            }
+            struct stat file_stat{};
+            fstat(descriptor, &file_stat);
+            size = static_cast<size_t>(file_stat.st_size);
+            if (size > 0) {
+                void *address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+                if (address == MAP_FAILED) {
+                    LOGGER.error << "Cannot map file: " << file_name << std::endl;
+                    exit(EIO);
+                }
+                data = static_cast<char *>(address);
+                madvise(data, size, MADV_SEQUENTIAL);
+            }
+        }
+
+        virtual ~mappedFile() {
+            if (data) { munmap(data, size); }
+            if (descriptor >= 0) { close(descriptor); }
+        }
+
+        mappedFile(const mappedFile &) = delete;
+
+        void operator=(const mappedFile &) = delete;
+
+        const char *begin() const { return data; }
+
+        const char *end() const { return data + size; }
+
+        size_t length() const { return size; }
+
+        /// Give back the pages of [begin() + from, begin() + to), which are not read again.
+        void release(size_t from, size_t to) const {
+            auto page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+            from = (from + page - 1) / page * page;
+            to = std::min(to, size) / page * page;
+            if (data && from < to) {
+                madvise(data + from, to - from, MADV_DONTNEED);
+            }
+        }
+
+    };
+
+}
+
+#endif //MDTOOLS_MAPPEDFILE_H
@@ -32,7 +32,7 @@ namespace mdtools {
 
     /// Defines an enumerator for the tasks
     enum class task_t : int {
-        PhononDOS = 1, DynamicStructureFactor, AxialDistributionHistogram,RadialDistributionHistogram, PairDistributionHistogram, RadiusOfGyration
+        PhononDOS = 1, DynamicStructureFactor, AxialDistributionHistogram,RadialDistributionHistogram, PairDistributionHistogram, RadiusOfGyration, RepackGzip, Convert
     };
 
     /// Map a string argument to a task enumerator.
@@ -42,7 +42,9 @@ namespace mdtools {
             {"AxialDistributionHistogram", task_t::AxialDistributionHistogram},
             {"RadialDistributionHistogram", task_t::RadialDistributionHistogram},
             {"PairDistributionHistogram", task_t::PairDistributionHistogram},
-            {"RadiusOfGyration", task_t::RadiusOfGyration}
+            {"RadiusOfGyration", task_t::RadiusOfGyration},
+            {"RepackGzip", task_t::RepackGzip},
+            {"Convert", task_t::Convert}
     };
 
     /// Defines an enumerator for the axis
@@ -80,10 +82,41 @@ namespace mdtools {
         std::string output_path;
         std::string trajectory_input_file;
         std::string coordinates_input_file;
+        std::string lammps_parser = "mmap";
+        std::string lammps_units = "real";
+        bool frame_index = false;
+        std::string xtc_decoder = "fast";
         int progress = 0;
+        std::string atom_types;
+        std::string atom_indices;
+        std::string index_file;
+        std::string index_group;
+        int prefetch_frames = 4;
 
         void validate() const {
-            open_file(trajectory_input_file, "Trajectory input file is missing");
+            for (auto &segment: list_input_files(trajectory_input_file)) {
+                open_file(segment, "Trajectory input file is missing");
+            }
+            if (lammps_parser != "mmap" && lammps_parser != "stream") {
+                std::throw_with_nested(std::runtime_error("io.lammps_parser should be one of [mmap,stream]"));
+            }
+            if (lammps_units != "real" && lammps_units != "metal") {
+                std::throw_with_nested(std::runtime_error("io.lammps_units should be one of [real,metal]"));
+            }
+            if (xtc_decoder != "fast" && xtc_decoder != "reference") {
+                std::throw_with_nested(std::runtime_error("io.xtc_decoder should be one of [fast,reference]"));
+            }
+            if (prefetch_frames < 0) {
+                std::throw_with_nested(std::runtime_error("io.prefetch_frames should be zero or positive number"));
+            }
+            parse_ranges(atom_types);
+            parse_ranges(atom_indices);
+            if (!index_group.empty()) {
+                if (index_file.empty()) {
+                    std::throw_with_nested(std::runtime_error("io.index_group requires io.index_file"));
+                }
+                read_index_group(index_file, index_group);
+            }
         }
     };
 
@@ -95,6 +128,8 @@ namespace mdtools {
         int start_iteration =0;
         int delta_iteration = 1;
         int end_iteration = -1;
+        std::string precision = "double";
+        std::string allocator = "arena";
 
         void validate() {
             if (time_step <= 0) {
@@ -110,6 +145,14 @@ namespace mdtools {
 
             if (end_iteration <= start_iteration){end_iteration = -1;}
 
+            if (precision != "float" && precision != "double") {
+                std::throw_with_nested(std::runtime_error("simulation.precision should be one of [float,double]"));
+            }
+
+            if (allocator != "arena" && allocator != "malloc") {
+                std::throw_with_nested(std::runtime_error("simulation.allocator should be one of [arena,malloc]"));
+            }
+
             if(atom_mass.empty()){
                 std::throw_with_nested(std::runtime_error("Empty mass map"));
 
@@ -249,6 +292,33 @@ namespace mdtools {
 
     };
 
+    struct repack_gzip_options_t {
+
+        int level = 6;
+
+        void validate() const {
+
+            if (level < 0 || level > 9) {
+                std::throw_with_nested(std::runtime_error("repack_gzip.level should be between 0 and 9"));
+            }
+
+        }
+
+    };
+
+    struct convert_options_t {
+
+        std::string precision = "double";
+
+        void validate() const {
+
+            if (precision != "float" && precision != "double") {
+                std::throw_with_nested(std::runtime_error("convert.precision should be one of [float,double]"));
+            }
+
+        }
+
+    };
 
 }
 
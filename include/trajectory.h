@@ -0,0 +1,481 @@
+// MDTools
+//     Copyright (C)  2025  Pablo Galaviz
+//
+//     This program is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+//
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+//
+//     You should have received a copy of the GNU General Public License
+//     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//
+// Created by Pablo Galaviz on 16/10/2026.
+//
+
+#ifndef MDTOOLS_TRAJECTORY_H
+#define MDTOOLS_TRAJECTORY_H
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "trajectoryArena.h"
+
+namespace mdtools {
+
+    /// Non owning view of size values placed stride values apart.
+    template<class T>
+    class strided_span {
+
+        T *first = nullptr;
+        size_t count = 0;
+        size_t step = 1;
+
+    public:
+
+        class iterator {
+            T *position;
+            size_t step;
+        public:
+            iterator(T *position, size_t step) : position(position), step(step) {}
+
+            T &operator*() const { return *position; }
+
+            iterator &operator++() {
+                position += step;
+                return *this;
+            }
+
+            bool operator!=(const iterator &other) const { return position != other.position; }
+        };
+
+        strided_span() = default;
+
+        strided_span(T *first, size_t size, size_t stride = 1) : first(first), count(size), step(stride) {}
+
+        T &operator[](size_t i) const { return first[i * step]; }
+
+        T *data() const { return first; }
+
+        size_t size() const { return count; }
+
+        size_t stride() const { return step; }
+
+        iterator begin() const { return {first, step}; }
+
+        iterator end() const { return {first + count * step, step}; }
+    };
+
+    template<class S>
+    static void periodic_boundary_correction(S &position, const double &dt, S &velocity){
+        auto p0 = position[0];
+        double idt = 1.0/dt;
+//        LOGGER.debug << abs(velocity).max() << " -> ";
+
+        for(int i=0; i < position.size()-1;i++){
+            auto pi=position[i];
+            auto pip1=position[i+1];
+            if(std::abs(pi-p0) > 0.5){
+                pi= pi>p0 ? pi-1 : pi+1;
+                position[i]=pi;
+            }
+            if(std::abs(pip1-p0) > 0.5){
+                pip1= pip1>p0 ? pip1-1 : pip1+1;
+                position[i+1]=pip1;
+            }
+
+            velocity[i+1]=static_cast<std::decay_t<decltype(velocity[0])>>((pip1-pi)*idt);
+        }
+        velocity[0]=velocity[1];
+//        LOGGER.debug << abs(velocity).max() << std::endl;
+    }
+
+    /// Sum of values accumulated in double, also for single precision storage.
+    template<class C>
+    inline double accumulate(const C &values) {
+        double result = 0;
+        for (auto value: values) { result += value; }
+        return result;
+    }
+
+    /// Per frame values stored for every atom of a trajectory.
+    enum class field_t : int {
+        POSITION_X = 0, POSITION_Y, POSITION_Z, VELOCITY_X, VELOCITY_Y, VELOCITY_Z, NUMBER_OF_FIELDS
+    };
+
+    /// Time and simulation box of one frame, shared by every atom. Lengths and origin are indexed by X, Y, Z.
+    struct frame_box_t {
+        double time = 0;
+        double origin[3] = {0, 0, 0};
+        double length[3] = {1, 1, 1};
+
+        void set(double frame_time, const double (&minimum)[3], const double (&maximum)[3]) {
+            time = frame_time;
+            for (int c = 0; c < 3; c++) {
+                origin[c] = minimum[c];
+                length[c] = maximum[c] - minimum[c];
+            }
+        }
+    };
+
+    /// Trajectory of one atom: every field is the contiguous run of its frames.
+    template<class T>
+    struct atom_view_t {
+        double time_step = 0;
+        int atom_type = 0;
+        strided_span<T> position_x;
+        strided_span<T> position_y;
+        strided_span<T> position_z;
+        strided_span<T> velocity_x;
+        strided_span<T> velocity_y;
+        strided_span<T> velocity_z;
+        // Time of every frame, read from the box table.
+        strided_span<const double> time;
+
+        double mean_position_x = 0;
+        double mean_position_y = 0;
+        double mean_position_z = 0;
+
+        double mean_velocity_x = 0;
+        double mean_velocity_y = 0;
+        double mean_velocity_z = 0;
+
+        std::string serialize() const {
+            std::stringstream result;
+            auto array = [&result](const char *name, const auto &values) {
+                result << "\"" << name << "\" : [ ";
+                for (auto item: values) { result << item << ","; }
+                result.seekp(-1, std::ios_base::end);
+                result << "]";
+            };
+            result << "{";
+            result << "\"time step\" : " << time_step << ",";
+            result << "\"atom_t type\" : " << atom_type << ",";
+            array("position x", position_x);
+            result << ",";
+            array("position y", position_y);
+            result << ",";
+            array("position z", position_z);
+            result << ",";
+            array("velocity x", velocity_x);
+            result << ",";
+            array("velocity y", velocity_y);
+            result << ",";
+            array("velocity z", velocity_z);
+            result << ",";
+            array("time", time);
+            result << "}";
+            return result.str();
+        }
+    };
+
+    /// One frame of a trajectory: every field is strided across the atoms.
+    template<class T>
+    struct frame_view_t {
+        strided_span<T> position_x;
+        strided_span<T> position_y;
+        strided_span<T> position_z;
+        strided_span<T> velocity_x;
+        strided_span<T> velocity_y;
+        strided_span<T> velocity_z;
+    };
+
+    /// Fields derived from the stored positions, computed when a module asks for them (see basic_trajectory_t::derive).
+    enum derived_t : int {
+        DERIVE_NONE = 0, UNWRAPPED = 1, VELOCITIES = 2, MEANS = 4, DERIVE_ALL = 7
+    };
+
+    /**
+     * Trajectory of every atom, T is the storage type of the per frame values (simulation.precision).
+     *
+     * Positions and velocities live in two 64 byte aligned slabs: a block per field, and in each block a row per
+     * atom with its frames (frame stride 1, atom stride the number of frames rounded up to 64 bytes). Every atom
+     * series starts on a cache line, so per atom loops are contiguous streams and per frame loops are fixed stride
+     * sweeps. Time and box are the same for every atom, they are kept once per frame in a table indexed by frame.
+     *
+     * The velocity slab only exists when the trajectory has velocities or a module derives them.
+     */
+    template<class T>
+    class basic_trajectory_t {
+
+        struct arena_deleter {
+            size_t bytes = 0;
+
+            void operator()(T *values) const { trajectoryArena::getInstance().release(values, bytes); }
+        };
+
+        using slab_t = std::unique_ptr<T[], arena_deleter>;
+
+        size_t atoms = 0;
+        size_t frames = 0;
+        size_t row = 0;
+        slab_t positions;
+        slab_t velocities;
+        std::vector<int> types;
+        std::vector<frame_box_t> boxes;
+        // Means of every atom: position x y z, velocity x y z.
+        std::vector<double> means;
+        int derived = DERIVE_NONE;
+
+        static constexpr int number_of_fields = static_cast<int>(field_t::NUMBER_OF_FIELDS);
+
+    public:
+        static constexpr size_t alignment = 64;
+
+        double time_step = 0;
+
+        // True while the positions are box fractions as read (wrapped), derive() unwraps them and converts them to nm.
+        bool scaled = false;
+
+        basic_trajectory_t() = default;
+
+        /**
+         * Zeroed storage for the positions of number_of_frames frames of number_of_atoms atoms. It is first
+         * touched in parallel by atom, as the loaders and modules go through it, unless touch is false and it
+         * comes from the arena (the pages are then touched by whoever writes them first).
+         */
+        basic_trajectory_t(size_t number_of_atoms, size_t number_of_frames, double time_step, bool touch = true) :
+                atoms(number_of_atoms), frames(number_of_frames), types(number_of_atoms), boxes(number_of_frames),
+                means(6 * number_of_atoms, 0.0), time_step(time_step) {
+            constexpr size_t values_per_line = alignment / sizeof(T);
+            row = (frames + values_per_line - 1) / values_per_line * values_per_line;
+            allocate(positions, touch);
+        }
+
+        /// Add the velocity fields, for loaders that read velocities.
+        void allocate_velocities(bool touch = true) {
+            if (!velocities) {
+                allocate(velocities, touch);
+            }
+        }
+
+        bool has_velocities() const { return static_cast<bool>(velocities); }
+
+        bool empty() const { return atoms == 0; }
+
+        size_t number_of_atoms() const { return atoms; }
+
+        size_t number_of_frames() const { return frames; }
+
+        /// Values between consecutive frames of an atom.
+        static constexpr size_t frame_stride() { return 1; }
+
+        /// Values between the same frame of consecutive atoms.
+        size_t atom_stride() const { return row; }
+
+        /// Values between consecutive position (or velocity) fields.
+        size_t field_stride() const { return atoms * row; }
+
+        /// First frame of a field of one atom, nullptr for velocities when there are none.
+        T *data(field_t field, size_t atom_id = 0) const {
+            auto id = static_cast<int>(field);
+            auto &slab = id < 3 ? positions : velocities;
+            return slab ? slab.get() + (id % 3) * field_stride() + atom_id * row : nullptr;
+        }
+
+        /// Frames of one atom (empty for missing velocities).
+        strided_span<T> series(field_t field, size_t atom_id) const {
+            auto values = data(field, atom_id);
+            return values ? strided_span<T>(values, frames) : strided_span<T>();
+        }
+
+        /// Atoms of one frame (empty for missing velocities).
+        strided_span<T> sweep(field_t field, size_t frame_id) const {
+            auto values = data(field);
+            return values ? strided_span<T>(values + frame_id, atoms, row) : strided_span<T>();
+        }
+
+        frame_box_t &box(size_t frame_id) { return boxes[frame_id]; }
+
+        const frame_box_t &box(size_t frame_id) const { return boxes[frame_id]; }
+
+        int &atom_type(size_t atom_id) { return types[atom_id]; }
+
+        int atom_type(size_t atom_id) const { return types[atom_id]; }
+
+        /// Mean over the frames of a position or velocity field, after derive(MEANS).
+        double mean(field_t field, size_t atom_id) const { return means[6 * atom_id + static_cast<int>(field)]; }
+
+        atom_view_t<T> atom(size_t atom_id) const {
+            atom_view_t<T> view;
+            view.time_step = time_step;
+            view.atom_type = types[atom_id];
+            view.position_x = series(field_t::POSITION_X, atom_id);
+            view.position_y = series(field_t::POSITION_Y, atom_id);
+            view.position_z = series(field_t::POSITION_Z, atom_id);
+            view.velocity_x = series(field_t::VELOCITY_X, atom_id);
+            view.velocity_y = series(field_t::VELOCITY_Y, atom_id);
+            view.velocity_z = series(field_t::VELOCITY_Z, atom_id);
+            view.time = {&boxes.data()->time, frames, sizeof(frame_box_t) / sizeof(double)};
+            auto mean = means.data() + 6 * atom_id;
+            view.mean_position_x = mean[0];
+            view.mean_position_y = mean[1];
+            view.mean_position_z = mean[2];
+            view.mean_velocity_x = mean[3];
+            view.mean_velocity_y = mean[4];
+            view.mean_velocity_z = mean[5];
+            return view;
+        }
+
+        frame_view_t<T> frame(size_t frame_id) const {
+            return {sweep(field_t::POSITION_X, frame_id), sweep(field_t::POSITION_Y, frame_id),
+                    sweep(field_t::POSITION_Z, frame_id), sweep(field_t::VELOCITY_X, frame_id),
+                    sweep(field_t::VELOCITY_Y, frame_id), sweep(field_t::VELOCITY_Z, frame_id)};
+        }
+
+        /// Copy every frame of source (same atoms) into the frames from first_frame on.
+        void copy_frames(const basic_trajectory_t &source, size_t first_frame) {
+            if (source.has_velocities()) {
+                allocate_velocities(false);
+            }
+            for (int field = 0; field < number_of_fields; field++) {
+                for (size_t atom_id = 0; atom_id < atoms; atom_id++) {
+                    auto values = source.data(static_cast<field_t>(field), atom_id);
+                    if (values != nullptr) {
+                        std::copy(values, values + source.frames, data(static_cast<field_t>(field), atom_id) + first_frame);
+                    }
+                }
+            }
+            std::copy(source.boxes.begin(), source.boxes.end(), boxes.begin() + first_frame);
+            types = source.types;
+        }
+
+        /// Keep only the first number_of_frames frames (e.g. after a truncated read), the strides do not change.
+        void truncate(size_t number_of_frames) {
+            frames = std::min(frames, number_of_frames);
+            boxes.resize(frames);
+        }
+
+        /**
+         * Compute the derived fields (derived_t) that are not there yet, in parallel over the atoms.
+         * UNWRAPPED: box fractions are unwrapped and converted to nm (also needed by the others).
+         * VELOCITIES: differenced from the positions, unless the trajectory has them.
+         * MEANS: mean position (and velocity, when there are velocities) of every atom.
+         */
+        void derive(int fields) {
+            fields &= ~derived;
+            if (fields == DERIVE_NONE) {
+                return;
+            }
+            bool unwrap = scaled;
+            bool difference = (fields & VELOCITIES) && !has_velocities();
+            if (difference) {
+                allocate_velocities(false);
+            }
+#pragma omp parallel
+            {
+                // Velocities of the unwrapping when they are not kept.
+                std::vector<T> scratch;
+#pragma omp for schedule(static)
+                for (long atom_id = 0; atom_id < static_cast<long>(atoms); atom_id++) {
+                    if (unwrap) {
+                        strided_span<T> velocity[3];
+                        if (difference) {
+                            velocity[0] = series(field_t::VELOCITY_X, atom_id);
+                            velocity[1] = series(field_t::VELOCITY_Y, atom_id);
+                            velocity[2] = series(field_t::VELOCITY_Z, atom_id);
+                        } else {
+                            scratch.resize(3 * frames);
+                            for (int c = 0; c < 3; c++) { velocity[c] = {scratch.data() + c * frames, frames}; }
+                        }
+                        unwrap_positions(atom_id, velocity);
+                    } else if (difference) {
+                        unwrapped_velocity(atom_id);
+                    }
+                    if (fields & MEANS) {
+                        calculate_means(atom_id);
+                    }
+                }
+            }
+            scaled = false;
+            derived |= fields | UNWRAPPED;
+        }
+
+    private:
+
+        void allocate(slab_t &slab, bool touch) {
+            size_t bytes = 3 * atoms * row * sizeof(T);
+            if (bytes == 0) {
+                return;
+            }
+            auto &arena = trajectoryArena::getInstance();
+            slab = slab_t(static_cast<T *>(arena.allocate(bytes, alignment)), arena_deleter{bytes});
+            if (!slab) {
+                throw std::bad_alloc();
+            }
+            // Blocks that do not come from the arena (allocator=malloc, or a full arena) are always zeroed.
+            if (touch || !arena.zeroed(slab.get())) {
+                auto values = slab.get();
+#pragma omp parallel for schedule(static)
+                for (long atom_id = 0; atom_id < static_cast<long>(atoms); atom_id++) {
+                    for (int field = 0; field < 3; field++) {
+                        std::fill_n(values + field * field_stride() + atom_id * row, row, T(0));
+                    }
+                }
+            }
+        }
+
+        /**
+         * Velocities differenced from the box fractions of an atom, which are unwrapped on the way, then both
+         * converted to nm with the lattice.
+         */
+        void unwrap_positions(size_t atom_id, const strided_span<T> (&velocity)[3]) {
+            constexpr field_t position_fields[3] = {field_t::POSITION_X, field_t::POSITION_Y, field_t::POSITION_Z};
+            for (int c = 0; c < 3; c++) {
+                auto position = series(position_fields[c], atom_id);
+                auto component = velocity[c];
+                difference(position, component);
+
+                double max = 0;
+                for (auto value: component) { max = std::max(max, static_cast<double>(std::abs(value))); }
+                if (max * time_step > 0.5) { periodic_boundary_correction(position, time_step, component); }
+
+                for (size_t i = 0; i < frames; i++) {
+                    position[i] = static_cast<T>(boxes[i].origin[c] + boxes[i].length[c] * position[i]);
+                    component[i] = static_cast<T>(component[i] * boxes[i].length[c]);
+                }
+            }
+        }
+
+        /// Velocities of positions that are already continuous and in nm (LAMMPS xu yu zu), without boundary correction.
+        void unwrapped_velocity(size_t atom_id) {
+            difference(series(field_t::POSITION_X, atom_id), series(field_t::VELOCITY_X, atom_id));
+            difference(series(field_t::POSITION_Y, atom_id), series(field_t::VELOCITY_Y, atom_id));
+            difference(series(field_t::POSITION_Z, atom_id), series(field_t::VELOCITY_Z, atom_id));
+        }
+
+        void calculate_means(size_t atom_id) {
+            auto number_of_frames = static_cast<double>(frames);
+            for (int i = 0; i < number_of_fields; i++) {
+                auto values = series(static_cast<field_t>(i), atom_id);
+                means[6 * atom_id + i] = values.size() > 0 ? accumulate(values) / number_of_frames : 0.0;
+            }
+        }
+
+        void difference(const strided_span<T> &position, const strided_span<T> &velocity) const {
+            if (frames < 2) {
+                for (auto &value: velocity) { value = 0; }
+                return;
+            }
+            double idt = 1.0 / time_step;
+            for (size_t i = 1; i < frames; i++) { velocity[i] = static_cast<T>((position[i] - position[i - 1]) * idt); }
+            velocity[0] = velocity[1];
+        }
+
+    };
+
+    using trajectory_t = basic_trajectory_t<double>;
+
+} // mdtools
+
+#endif //MDTOOLS_TRAJECTORY_H
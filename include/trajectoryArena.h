@@ -0,0 +1,99 @@
+// MDTools
+//     Copyright (C)  2025  Pablo Galaviz
+//
+//     This program is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+//
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+//
+//     You should have received a copy of the GNU General Public License
+//     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//
+// Created by Pablo Galaviz on 16/10/2026.
+//
+
+#ifndef MDTOOLS_TRAJECTORYARENA_H
+#define MDTOOLS_TRAJECTORYARENA_H
+
+#include <cstddef>
+#include <mutex>
+
+namespace mdtools {
+
+    enum class allocator_t : int {
+        ARENA = 0, MALLOC
+    };
+
+    /**
+     * Memory of the trajectory stores (simulation.allocator).
+     *
+     * The arena reserves one large region of address space on first use and hands out blocks aligned to huge
+     * pages from it. The region is backed by explicit huge pages (MAP_HUGETLB), reserved up front from the free
+     * ones of the system pool, and by transparent huge pages otherwise. Released blocks give their pages back
+     * to the system.
+     * With malloc the blocks come from aligned_alloc, to compare against.
+     */
+    class trajectoryArena {
+
+        struct region_t {
+            char *begin = nullptr;
+            size_t capacity = 0;
+            size_t used = 0;
+
+            bool contains(const void *address) const {
+                return begin != nullptr && address >= begin && address < begin + capacity;
+            }
+        };
+
+        std::mutex mutex;
+        allocator_t allocator = allocator_t::ARENA;
+        bool reserved = false;
+        // Explicit huge pages first, then transparent huge pages.
+        region_t regions[2];
+        size_t allocated = 0;
+        size_t peak = 0;
+
+        trajectoryArena() = default;
+
+        void reserve();
+
+    public:
+
+        static constexpr size_t huge_page_size = size_t(2) << 20;
+
+        static trajectoryArena &getInstance() {
+            static trajectoryArena instance;
+            return instance;
+        }
+
+        trajectoryArena(const trajectoryArena &) = delete;
+
+        void operator=(const trajectoryArena &) = delete;
+
+        ~trajectoryArena();
+
+        void use(allocator_t selected) { allocator = selected; }
+
+        /// Whether the block at address comes from the arena, whose pages read as zero until they are written.
+        bool zeroed(const void *address) const {
+            return regions[0].contains(address) || regions[1].contains(address);
+        }
+
+        /// Block of bytes aligned to alignment (at most a huge page), nullptr when out of memory.
+        void *allocate(size_t bytes, size_t alignment);
+
+        void release(void *address, size_t bytes);
+
+        /// Log the peak of trajectory memory and how it was backed.
+        void logSummary();
+    };
+
+} // mdtools
+
+#endif //MDTOOLS_TRAJECTORYARENA_H
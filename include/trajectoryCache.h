@@ -0,0 +1,95 @@
+// MDTools
+//     Copyright (C)  2025  Pablo Galaviz
+//
+//     This program is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+//
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+//
+//     You should have received a copy of the GNU General Public License
+//     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//
+// Created by Pablo Galaviz on 16/10/2026.
+//
+
+#ifndef MDTOOLS_TRAJECTORYCACHE_H
+#define MDTOOLS_TRAJECTORYCACHE_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "mappedFile.h"
+#include "trajectoryReader.h"
+
+namespace mdtools {
+
+    /**
+     * Binary trajectory cache (".mdcache"), read through a memory mapping without any parsing.
+     * Layout, every section aligned to 64 bytes:
+     *   header | atom types (int32) | frame blocks | box table
+     * A frame block holds the x, y and z positions of all atoms as box fractions, one column after
+     * the other, in float or double. The box table has one cache_box_t per frame.
+     */
+
+    constexpr size_t cache_alignment = 64;
+
+    inline size_t cache_padded(size_t bytes) { return (bytes + cache_alignment - 1) / cache_alignment * cache_alignment; }
+
+    struct cache_header_t {
+        char magic[8];
+        uint32_t version;
+        // Bytes per position, 4 (float) or 8 (double).
+        uint32_t value_size;
+        uint64_t number_of_atoms;
+        uint64_t number_of_frames;
+        uint64_t atom_type_offset;
+        uint64_t frame_offset;
+        // Bytes per frame block, each column is padded to the alignment.
+        uint64_t frame_stride;
+        uint64_t box_offset;
+    };
+
+    static_assert(sizeof(cache_header_t) == cache_alignment, "cache header should fill one aligned block");
+
+    struct cache_box_t {
+        int64_t time_step_id;
+        int64_t reserved;
+        double minimum[3];
+        double maximum[3];
+    };
+
+    /// Header of a mapped cache file, nullptr if the file is not a valid cache.
+    const cache_header_t *read_cache_header(const mappedFile &file);
+
+    /**
+     * Writes frames into a cache file as they are read, the header and the box table are written by close().
+     */
+    class trajectoryCacheWriter {
+
+        std::ofstream output;
+        cache_header_t header{};
+        std::vector<cache_box_t> boxes;
+        std::vector<char> block;
+
+    public:
+
+        trajectoryCacheWriter(const std::string &file_name, bool single_precision);
+
+        /// Append a frame, positions in nm (unscaled frames) are stored as box fractions.
+        void write(const frame &current);
+
+        /// Write the box table and the header. Returns false if the file could not be written.
+        bool close();
+
+    };
+
+}
+
+#endif //MDTOOLS_TRAJECTORYCACHE_H
@@ -21,6 +21,8 @@
 #ifndef MDTOOLS_TRAJECTORYREADER_H
 #define MDTOOLS_TRAJECTORYREADER_H
 
+#include <chrono>
+#include <memory>
 #include <string>
 #include <valarray>
 
@@ -30,12 +32,19 @@
 #include <boost/iostreams/filter/gzip.hpp>
 #include <boost/iostreams/filtering_streambuf.hpp>
 #include "logger.h"
+#include "atomSelection.h"
+#include "frameIndex.h"
+#include "mappedFile.h"
+#include "parameters.h"
+#include "trajectory.h"
+#include "xdrfile/xdrfile.h"
+#include "xdrfile/xdrfile_trr.h"
 
 namespace mdtools {
 
     // First 4 bits is file ID, the fifth bit is compression flag.
     enum format_t : int {
-        UNKNOWN = 0b0000'0000, LAMMPS = 0b0000'0001, XDATCAR = 0b0000'0010, TRR = 0b0000'0100, XTC = 0b0000'1000, GRO = 0b0001'0000, LAMMPS_GZ = 0b1000'0001,
+        UNKNOWN = 0b0000'0000, LAMMPS = 0b0000'0001, XDATCAR = 0b0000'0010, TRR = 0b0000'0100, XTC = 0b0000'1000, GRO = 0b0001'0000, CACHE = 0b0010'0000, LAMMPS_GZ = 0b1000'0001,
         GZIP = 0b1000'0000 , FILE_TYPE = 0b0111'1111,
     };
 
@@ -43,6 +52,11 @@ namespace mdtools {
 
     inline format_t file_format(std::string name) {
 
+        // VASP trajectories have no extension, only the file name is checked (the directories may have dots).
+        if (name.substr(name.find_last_of('/') + 1) == "XDATCAR") {
+            return format_t::XDATCAR;
+        }
+
         std::vector<std::string> name_vec;
         boost::algorithm::split(name_vec, name, boost::is_any_of("."));
         size_t name_size = name_vec.size();
@@ -68,13 +82,8 @@ namespace mdtools {
             if (ext1 == "gro") {
                 return format_t::GRO;
             }
-        }
-        else{
-            if(name_size ==1){
-                if (name == "XDATCAR") {
-                    return format_t::XDATCAR;
-                }
-
+            if (ext1 == "mdcache") {
+                return format_t::CACHE;
             }
         }
 
@@ -94,11 +103,40 @@ namespace mdtools {
     struct frame {
         int time_step_id = -1;
         size_t number_of_atoms = 0;
+        // True when positions are fractions of the box (LAMMPS xs ys zs), false when they are in nm.
+        bool scaled = false;
+        // True when positions are continuous across the periodic boundaries (LAMMPS xu yu zu), they are in nm.
+        bool unwrapped = false;
         std::vector<box> lattice = std::vector<box>(3);
         std::valarray<double> position_x;
         std::valarray<double> position_y;
         std::valarray<double> position_z;
         std::valarray<int> atom_type;
+        // Velocities in nm/fs when the trajectory has them (LAMMPS vx vy vz), empty otherwise.
+        std::valarray<double> velocity_x;
+        std::valarray<double> velocity_y;
+        std::valarray<double> velocity_z;
+
+        void resize(size_t size) {
+            number_of_atoms = size;
+            if (position_x.size() != size) {
+                position_x.resize(size);
+                position_y.resize(size);
+                position_z.resize(size);
+                atom_type.resize(size);
+            }
+        }
+
+        void resize_velocities(bool enable) {
+            size_t size = enable ? number_of_atoms : 0;
+            if (velocity_x.size() != size) {
+                velocity_x.resize(size);
+                velocity_y.resize(size);
+                velocity_z.resize(size);
+            }
+        }
+
+        bool has_velocities() const { return number_of_atoms > 0 && velocity_x.size() == number_of_atoms; }
 
         void reset() {
             time_step_id = -1;
@@ -112,161 +150,167 @@ namespace mdtools {
     };
 
 
-    static void periodic_boundary_correction(std::valarray<double> &position, const double &dt, std::valarray<double> &velocity){
-        auto p0 = position[0];
-        double idt = 1.0/dt;
-//        LOGGER.debug << abs(velocity).max() << " -> ";
-
-        for(int i=0; i < position.size()-1;i++){
-            auto pi=position[i];
-            auto pip1=position[i+1];
-            if(abs(pi-p0) > 0.5){
-                pi= pi>p0 ? pi-1 : pi+1;
-                position[i]=pi;
-            }
-            if(abs(pip1-p0) > 0.5){
-                pip1= pip1>p0 ? pip1-1 : pip1+1;
-                position[i+1]=pip1;
-            }
-
-            velocity[i+1]=(pip1-pi)*idt;
-        }
-        velocity[0]=velocity[1];
-//        LOGGER.debug << abs(velocity).max() << std::endl;
+    /// A frame id is selected when it is start_iteration + k*delta_iteration and smaller than end_iteration (if positive).
+    inline bool is_selected_frame(long frame_id, int start_iteration, int delta_iteration, int end_iteration) {
+        return frame_id >= start_iteration && (frame_id - start_iteration) % delta_iteration == 0 &&
+               (end_iteration <= 0 || frame_id < end_iteration);
     }
 
-    struct atom_t {
-        double time_step=0;
-        int atom_type=0;
-        std::valarray<double> position_x;
-        std::valarray<double> position_y;
-        std::valarray<double> position_z;
-
-        double mean_position_x;
-        double mean_position_y;
-        double mean_position_z;
-
-        std::valarray<double> velocity_x;
-        std::valarray<double> velocity_y;
-        std::valarray<double> velocity_z;
-
-        double mean_velocity_x;
-        double mean_velocity_y;
-        double mean_velocity_z;
-
-        std::valarray<double> time;
-        std::valarray<double> lattice_a;
-        std::valarray<double> lattice_b;
-        std::valarray<double> lattice_c;
-
-        std::valarray<double> lattice_origin_x;
-        std::valarray<double> lattice_origin_y;
-        std::valarray<double> lattice_origin_z;
-
-
-        std::string serialize(){
-            std::stringstream  result;
-            result << "{";
-            result << "\"time step\" : " << time_step << ",";
-            result << "\"atom_t type\" : " << atom_type << ",";
-            result << "\"position x\" : [ ";
-            for(auto item : position_x){result << item << ",";}
-            result.seekp(-1, std::ios_base::end);
-            result << "],";
-            result << "\"position y\" : [ ";
-            for(auto item : position_y){result << item << ",";}
-            result.seekp(-1, std::ios_base::end);
-            result << "],";
-            result << "\"position z\" : [ ";
-            for(auto item : position_z){result << item << ",";}
-            result.seekp(-1, std::ios_base::end);
-            result << "],";
-            result << "\"velocity x\" : [ ";
-            for(auto item : velocity_x){result << item << ",";}
-            result.seekp(-1, std::ios_base::end);
-            result << "],";
-            result << "\"velocity y\" : [ ";
-            for(auto item : velocity_y){result << item << ",";}
-            result.seekp(-1, std::ios_base::end);
-            result << "],";
-            result << "\"velocity z\" : [ ";
-            for(auto item : velocity_z){result << item << ",";}
-            result.seekp(-1, std::ios_base::end);
-            result << "],";
-            result << "\"time\" : [ ";
-            for(auto item : time){result << item << ",";}
-            result.seekp(-1, std::ios_base::end);
-            result << "]";
-            result << "}";
-            return result.str();
-        }
-
-        void calculate_velocity(){
-            double idt= 1.0/time_step;
-            velocity_x = idt*(position_x-position_x.shift(-1));
-            velocity_x[0]=velocity_x[1];
-            velocity_y = idt*(position_y-position_y.shift(-1));
-            velocity_y[0]=velocity_y[1];
-            velocity_z = idt*(position_z-position_z.shift(-1));
-            velocity_z[0]=velocity_z[1];
-
-            auto max_x=abs(velocity_x).max()*time_step;
-            if(max_x > 0.5){periodic_boundary_correction(position_x,time_step,velocity_x);}
-
-            auto max_y=abs(velocity_y).max()*time_step;
-            if(max_y > 0.5){periodic_boundary_correction(position_y,time_step,velocity_y);}
-
-            auto max_z=abs(velocity_z).max()*time_step;
-            if(max_z > 0.5){periodic_boundary_correction(position_z,time_step,velocity_z);}
-
-            position_x = lattice_origin_x+lattice_a*position_x;
-            position_y = lattice_origin_y+lattice_b*position_y;
-            position_z = lattice_origin_z+lattice_c*position_z;
-
-            velocity_x *= lattice_a;
-            velocity_y *= lattice_b;
-            velocity_z *= lattice_c;
-
-        }
-
-        void calculate_means(){
-            auto number_of_frames=static_cast<double >(position_x.size());
-
-            mean_position_x = position_x.sum()/number_of_frames;
-            mean_position_y = position_y.sum()/number_of_frames;
-            mean_position_z = position_z.sum()/number_of_frames;
-
-            mean_velocity_x = velocity_x.sum()/number_of_frames;
-            mean_velocity_y = velocity_y.sum()/number_of_frames;
-            mean_velocity_z = velocity_z.sum()/number_of_frames;
-
-
-        }
+    /// Number of selected frames out of number_of_frames frames in the file.
+    inline size_t selected_frames(size_t number_of_frames, int start_iteration, int delta_iteration, int end_iteration) {
+        if (end_iteration > 0) { number_of_frames = std::min(number_of_frames, static_cast<size_t>(end_iteration)); }
+        if (number_of_frames <= start_iteration) { return 0; }
+        return (number_of_frames - start_iteration + delta_iteration - 1) / delta_iteration;
+    }
 
-    };
+    struct xdatcar_header_t;
+    struct cache_header_t;
+    struct lammps_columns_t;
 
     class trajectoryReader {
 
-        std::istream *input_stream;
+        std::istream *input_stream = nullptr;
         std::ifstream file;
         boost::iostreams::filtering_streambuf<boost::iostreams::input> input_buffer;
         std::string file_name;
+        format_t format = format_t::UNKNOWN;
+        std::unique_ptr<mappedFile> mapped_file;
+        const char *cursor = nullptr;
+        std::unique_ptr<frameIndex> frame_index;
+        std::unique_ptr<xdatcar_header_t> xdatcar_header;
+        std::unique_ptr<lammps_columns_t> lammps_columns;
+        bool lammps_frame_index = false;
+        std::unique_ptr<std::streambuf> blocked_gzip;
+        const cache_header_t *cache = nullptr;
+
+        // Multi-segment input (restarted runs), read through one reader per segment file.
+        std::vector<std::string> segments;
+        io_options_t segment_options;
+        std::vector<int> segment_first_step;
+        size_t segment_id = 0;
+        std::unique_ptr<trajectoryReader> segment_reader;
+
+        // Frame iterator state
+        int start_iteration = 0;
+        int delta_iteration = 1;
+        int end_iteration = -1;
+        long frame_id = 0;
+        int number_of_atoms = 0;
+        bool read_velocities = true;
+        int derived_fields = DERIVE_NONE;
+        XDRFILE *xdr = nullptr;
+        trr_context *trr = nullptr;
+        std::vector<float> coordinates;
+        std::vector<float> trr_velocities;
+        std::vector<int> atom_type;
+        std::map<std::string, int> map_atom_id;
+        atomSelection selection;
+        std::valarray<double> reference_x;
+        std::valarray<double> reference_y;
+        std::valarray<double> reference_z;
+        std::chrono::steady_clock::time_point read_start;
 
         static std::string removeNumbers(const std::string& input);
+        int getAtomTypeFromGroLine(const std::string &line);
         std::vector<int> getAtomTypeFromGro();
 
-        std::vector<atom_t> (trajectoryReader::*getTrajectory)(double time_step, int start_iteration, int delta_iteration ,int end_iteration);
-        std::vector<atom_t> getLammpsTrajectory(double time_step, int start_iteration, int delta_iteration, int end_iteration);
-        std::vector<atom_t> getXDATCARTrajectory(double time_step, int start_iteration, int delta_iteration, int end_iteration);
-        std::vector<atom_t> getXTCTrajectory(double time_step, int start_iteration, int delta_iteration, int end_iteration);
-        std::vector<atom_t> getTRRTrajectory(double time_step, int start_iteration, int delta_iteration, int end_iteration);
+        // Read the selected frames of the whole trajectory, formats decoded straight into atoms (lammps, TRR, cache)
+        // have none.
+        std::vector<frame> (trajectoryReader::*readTrajectory)() = nullptr;
+        std::vector<frame> readGroTrajectory();
+        std::vector<frame> readXTCTrajectory();
+        std::vector<frame> readSegmentTrajectory();
+        template<class T>
+        basic_trajectory_t<T> getLammpsTrajectory(double time_step);
+        template<class T>
+        basic_trajectory_t<T> getMappedLammpsTrajectory(double time_step);
+        template<class T>
+        basic_trajectory_t<T> getTRRTrajectory(double time_step);
+        template<class T>
+        basic_trajectory_t<T> getCacheTrajectory(double time_step);
+        template<class T>
+        static basic_trajectory_t<T> getAtomTrajectory(const std::vector<frame> &trajectory, double time_step);
+        // Store the first count frames in the atom series from first_frame on, with their boxes.
+        template<class T>
+        static void storeFrames(const std::vector<frame> &frames, size_t count, basic_trajectory_t<T> &trajectory,
+                                size_t first_frame);
+
+        // Read (or skip) the next frame of the file into current, reusing its buffers. The time step is set either way.
+        bool (trajectoryReader::*readFrame)(frame &current, bool skip) = nullptr;
+        bool readLammpsFrame(frame &current, bool skip);
+        bool readMappedLammpsFrame(frame &current, bool skip);
+        // Parse the lammps dump from memory (the file or its inflated blocks) from now on.
+        void mapLammpsTrajectory(std::unique_ptr<mappedFile> memory);
+        void loadLammpsFrameIndex();
+        void logLammpsColumns() const;
+        void seekSelectedFrame();
+        void setXDRFrameIndex(int64_t *offsets, unsigned long number_of_frames);
+        bool skipXTCFrame(frame &current);
+        bool readGroFrame(frame &current, bool skip);
+        bool readXDATCARFrame(frame &current, bool skip);
+        bool readCacheFrame(frame &current, bool skip);
+        std::vector<frame> readMappedXDATCARTrajectory();
+        void logXDATCARSpecies() const;
+        bool readTRRFrame(frame &current, bool skip);
+        bool readXTCFrame(frame &current, bool skip);
+        void setXTCFrame(frame &current, int step, const matrix box, const std::vector<float> &x) const;
+        std::unique_ptr<trajectoryReader> openSegment(size_t segment) const;
+        bool readSegmentFrame(frame &current, bool skip);
+        bool overlapsNextSegment(size_t segment, int time_step_id) const;
+        std::vector<int> scanTimeSteps();
+        void resolveSelection(const std::vector<int> &types);
+        void selectAtoms(frame &current);
+        const atomSelection *activeSelection() const { return selection.active() ? &selection : nullptr; }
+        bool readNext(frame &current);
+        void unscale(frame &current);
+        size_t bytesRead();
+        void logReadingRate();
 
     public:
-        explicit trajectoryReader(const std::string& file_name,const std::string& coordinates_file_name);
+        explicit trajectoryReader(const io_options_t &io_options);
 
         virtual ~trajectoryReader();
 
-        inline std::vector<atom_t> get(double time_step, int start_iteration, int delta_iteration, int end_iteration) {return (this->*getTrajectory)(time_step,start_iteration,delta_iteration,end_iteration);}
+        /**
+         * Whether get() reads the velocities stored in the trajectory (TRR). When disabled the
+         * velocity blocks are skipped and the atom velocities are left at zero. Frame by frame (segmented
+         * input, next()) they are only read for a module that derives VELOCITIES.
+         */
+        void readVelocities(bool enable) { read_velocities = enable; }
+
+        /**
+         * Fields (derived_t) get() derives from the positions, in parallel over the atoms, for a module that needs
+         * them. Without UNWRAPPED (or any other) the positions of box-scaled formats are left as box fractions.
+         */
+        void derive(int fields) { derived_fields = fields; }
+
+        /**
+         * Read the frames start_iteration + k*delta_iteration (< end_iteration if positive) into one contiguous
+         * trajectory of every atom, stored as T (float or double).
+         */
+        template<class T = double>
+        basic_trajectory_t<T> get(double time_step, int start_iteration, int delta_iteration, int end_iteration);
+
+        /**
+         * Write the frames start_iteration + k*delta_iteration (< end_iteration if positive) into a binary
+         * trajectory cache, which can then be used as trajectory input.
+         * @return the number of frames written, or -1 if the cache could not be written.
+         */
+        long writeCache(const std::string &cache_file_name, int start_iteration, int delta_iteration,
+                        int end_iteration, bool single_precision);
+
+        /**
+         * Start streaming the frames start_iteration + k*delta_iteration (< end_iteration if positive).
+         * Call once, before the first next().
+         */
+        void begin(int start_iteration, int delta_iteration, int end_iteration);
+
+        /**
+         * Read the next selected frame into current, reusing its buffers. Positions are returned in nm;
+         * box-scaled formats (lammps, gro) are unwrapped with respect to the first frame.
+         * @return false when the trajectory is exhausted.
+         */
+        bool next(frame &current);
 
     };
 
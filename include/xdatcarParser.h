@@ -0,0 +1,71 @@
+// MDTools
+//     Copyright (C)  2025  Pablo Galaviz
+//
+//     This program is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+//
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+//
+//     You should have received a copy of the GNU General Public License
+//     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//
+// Created by Pablo Galaviz on 16/10/2026.
+//
+
+#ifndef MDTOOLS_XDATCARPARSER_H
+#define MDTOOLS_XDATCARPARSER_H
+
+#include <string>
+#include <vector>
+#include "lammpsParser.h"
+#include "trajectoryReader.h"
+
+namespace mdtools {
+
+    /**
+     * Parser for VASP XDATCAR files held in memory, built on the lammps tokenizer.
+     * A file is a header (title, scale, lattice vectors, species, counts) followed by
+     * "Direct configuration= n" blocks. Variable cell runs repeat the header before every block.
+     */
+
+    struct xdatcar_header_t {
+        // Lattice vectors in Angstrom, already multiplied by the scale factor.
+        double lattice[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+        std::vector<std::string> species;
+        std::vector<int> counts;
+
+        int number_of_atoms() const;
+    };
+
+    /// Returns the beginning of the count-th line before position, or begin.
+    const char *previous_lines(const char *begin, const char *position, int count);
+
+    /// Returns the beginning of every "configuration=" line in [position, end).
+    std::vector<const char *> find_xdatcar_frames(const char *position, const char *end);
+
+    /**
+     * Parse the header starting at position.
+     * @return the position after the counts line or nullptr if the header is incomplete.
+     */
+    const char *parse_xdatcar_header(const char *position, const char *end, xdatcar_header_t &header);
+
+    /**
+     * Parse (or skip) the configuration starting at position, using the cell of header.
+     * @param number_of_atoms expected number of atoms, set from the header when zero.
+     * @param status an inconsistent number of atoms, to be reported by the caller.
+     * @param selection when given, only the selected atoms are converted and stored in their slots.
+     * @return the position after the configuration or nullptr if it is incomplete.
+     */
+    const char *parse_xdatcar_frame(const char *position, const char *end, const xdatcar_header_t &header,
+                                    frame &current, int &number_of_atoms, bool skip, frame_status_t &status,
+                                    const atomSelection *selection = nullptr);
+
+}
+
+#endif //MDTOOLS_XDATCARPARSER_H
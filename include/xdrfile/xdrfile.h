@@ -115,7 +115,9 @@ typedef float rvec[DIM];
  *
  *  Use this routine much like calls to the standard library function
  *  fopen(). The only difference is that the returned pointer should only
- *  be used with routines defined in this header.
+ *  be used with routines defined in this header. In read mode the file
+ *  is memory mapped when the platform allows it, otherwise it is read
+ *  through stdio.
  *
  *  \param path  Full or relative path (including name) of the file
  *  \param mode  "r" for reading, "w" for writing, "a" for append.
@@ -125,6 +127,20 @@ typedef float rvec[DIM];
  */
 XDRFILE* xdrfile_open(const char* path, const char* mode);
 
+/*! \brief Open another handle on a file opened for reading
+ *
+ *  Files opened for reading are memory mapped when possible. The new
+ *  handle shares the mapping of \a xfp, starting at the beginning of the
+ *  file with its own position, so concurrent readers do not map or buffer
+ *  the file again. Close it with xdrfile_close().
+ *
+ *  \param xfp  Handle returned by xdrfile_open() in read mode
+ *
+ *  \return Pointer to abstract xdr file datatype, or NULL if \a xfp is not
+ *          memory mapped (fall back to xdrfile_open()) or an error occurs.
+ */
+XDRFILE* xdrfile_dup(XDRFILE* xfp);
+
 /*! \brief Close a previously opened portable binary file, just like fclose()
  *
  *  Use this routine much like calls to the standard library function
@@ -430,6 +446,15 @@ int xdrfile_compress_coord_float(float* ptr, int ncoord, float precision, XDRFIL
  */
 int xdrfile_decompress_coord_float(float* ptr, int* ncoord, float* precision, XDRFILE* xfp);
 
+/*! \brief Select the decoder used by xdrfile_decompress_coord_float
+ *
+ *  The optimised decoder (default) gives bit-identical results to the
+ *  reference implementation, which is kept for validation.
+ *
+ *  \param enable     1 for the optimised decoder, 0 for the reference one.
+ */
+void xdrfile_set_fast_decompression(int enable);
+
 /*! \brief Compress coordiates in a double array to XDR file
  *
  *  This routine will perform \a lossy compression on the three-dimensional
@@ -51,6 +51,27 @@ int read_trr_header(const char* fn, int* natoms, unsigned long* nframes, int64_t
 int read_trr(XDRFILE* xd, int natoms, int* step, float* t, float* lambda, matrix box, rvec* x,
              rvec* v, rvec* f, uint8_t* has_prop);
 
+/* Decoding state reused across frames: the frame header and the scratch
+ * buffer for double precision (or discarded) arrays are kept, so reading a
+ * frame with read_trr_context does no heap allocation once the buffer has
+ * grown to the frame size. Single precision arrays are decoded straight into
+ * x, v and f. Create one per open file (or per thread) and free it after use. */
+typedef struct trr_context trr_context;
+
+trr_context* trr_context_create(void);
+
+void trr_context_free(trr_context* ctx);
+
+/* Select the blocks decoded by read_trr_context as a combination of
+ * TRR_HAS_POSITIONS, TRR_HAS_VELOCITIES and TRR_HAS_FORCES (default all).
+ * Other blocks are skipped with a seek and the matching arrays are left
+ * untouched; has_prop still reports what the frame contains. */
+void trr_context_set_fields(trr_context* ctx, uint8_t fields);
+
+/* Same as read_trr, using the buffers of ctx. */
+int read_trr_context(trr_context* ctx, XDRFILE* xd, int natoms, int* step, float* t, float* lambda,
+                     matrix box, rvec* x, rvec* v, rvec* f, uint8_t* has_prop);
+
 /* Write a frame to trr file */
 int write_trr(XDRFILE* xd, int natoms, int step, float t, float lambda, matrix box, rvec* x,
               rvec* v, rvec* f);
@@ -25,25 +25,24 @@
 
 namespace mdtools {
 
-    void mainAxialDistributionHistogram(const axial_distribution_histogram_options_t &axial_distribution_histogram,
-                                        const io_options_t &io_options, simulation_options_t simulation_options) {
-
-        auto trajectory = trajectoryReader(io_options.trajectory_input_file, io_options.coordinates_input_file).get(
-                simulation_options.time_step, simulation_options.start_iteration, simulation_options.delta_iteration,
-                simulation_options.end_iteration);
+    template<class T>
+    static void axialDistributionHistogram(const basic_trajectory_t<T> &trajectory,
+                                           const axial_distribution_histogram_options_t &axial_distribution_histogram,
+                                           const io_options_t &io_options) {
 
         if (trajectory.empty()) {
             LOGGER.error << "AxialDistributionHistogram failed" << std::endl;
             return;
         }
 
-        auto n = trajectory[0].position_x.size();
+        auto n = trajectory.number_of_frames();
         LOGGER.info << "Reading done. Number of frames: " << n << std::endl;
 
         std::map<int, boost::histogram::histogram<std::tuple<boost::histogram::axis::regular<double>>>> histograms{};
 
         auto axis = str2axis[axial_distribution_histogram.axis];
-        for (auto &atom: trajectory) {
+        for (size_t atom_id = 0; atom_id < trajectory.number_of_atoms(); atom_id++) {
+            auto atom = trajectory.atom(atom_id);
             if (histograms.find(atom.atom_type) == histograms.end()) {
                 histograms[atom.atom_type] = boost::histogram::make_histogram(
                         boost::histogram::axis::regular<>(axial_distribution_histogram.size,
@@ -51,12 +50,13 @@ namespace mdtools {
                                                           axial_distribution_histogram.stop, "r"));
             }
             for (int i = 0; i < n; i++) {
-                auto cx = 0.5 * (atom.lattice_origin_x[i] + atom.lattice_a[i]);
-                auto cy = 0.5 * (atom.lattice_origin_y[i] + atom.lattice_b[i]);
-                auto cz = 0.5 * (atom.lattice_origin_z[i] + atom.lattice_c[i]);
-                auto x = axis == axis_t::X ? 0 : atom.position_x[i] - cx;
-                auto y = axis == axis_t::Y ? 0 : atom.position_y[i] - cy;
-                auto z = axis == axis_t::Z ? 0 : atom.position_z[i] - cz;
+                auto &box = trajectory.box(i);
+                double cx = 0.5 * (box.origin[X] + box.length[X]);
+                double cy = 0.5 * (box.origin[Y] + box.length[Y]);
+                double cz = 0.5 * (box.origin[Z] + box.length[Z]);
+                double x = axis == axis_t::X ? 0 : atom.position_x[i] - cx;
+                double y = axis == axis_t::Y ? 0 : atom.position_y[i] - cy;
+                double z = axis == axis_t::Z ? 0 : atom.position_z[i] - cz;
                 auto r = sqrt(x * x + y * y + z * z);
                 histograms[atom.atom_type](r);
             }
@@ -72,4 +72,23 @@ namespace mdtools {
         }
     }
 
+    void mainAxialDistributionHistogram(const axial_distribution_histogram_options_t &axial_distribution_histogram,
+                                        const io_options_t &io_options, simulation_options_t simulation_options) {
+
+        auto reader = trajectoryReader(io_options);
+        reader.readVelocities(false);
+        reader.derive(UNWRAPPED);
+        if (simulation_options.precision == "float") {
+            axialDistributionHistogram(reader.get<float>(simulation_options.time_step, simulation_options.start_iteration,
+                                                         simulation_options.delta_iteration,
+                                                         simulation_options.end_iteration),
+                                       axial_distribution_histogram, io_options);
+        } else {
+            axialDistributionHistogram(reader.get<double>(simulation_options.time_step, simulation_options.start_iteration,
+                                                          simulation_options.delta_iteration,
+                                                          simulation_options.end_iteration),
+                                       axial_distribution_histogram, io_options);
+        }
+    }
+
 } // mdtools
\ No newline at end of file
@@ -0,0 +1,48 @@
+// MDTools
+//     Copyright (C)  2025  Pablo Galaviz
+//
+//     This program is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+//
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+//
+//     You should have received a copy of the GNU General Public License
+//     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//
+// Created by Pablo Galaviz on 16/10/2026.
+//
+
+#include "mainConvert.h"
+#include "trajectoryReader.h"
+#include "logger.h"
+#include <boost/filesystem.hpp>
+
+namespace mdtools {
+
+    void mainConvert(const convert_options_t &convert_options, const io_options_t &io_options,
+                     const simulation_options_t &simulation_options) {
+
+        auto input_files = list_input_files(io_options.trajectory_input_file);
+        auto input_path = boost::filesystem::path(input_files.empty() ? io_options.trajectory_input_file : input_files[0]);
+        auto output_file_name = io_options.output_path + "/" + input_path.filename().string() + ".mdcache";
+
+        LOGGER.info << "Converting " << io_options.trajectory_input_file << " into " << output_file_name << std::endl;
+        auto number_of_frames = trajectoryReader(io_options).writeCache(
+                output_file_name, simulation_options.start_iteration, simulation_options.delta_iteration,
+                simulation_options.end_iteration, convert_options.precision == "float");
+
+        if (number_of_frames < 0) {
+            LOGGER.error << "Convert failed writing " << output_file_name << std::endl;
+            return;
+        }
+        LOGGER.info << "Number of frames: " << number_of_frames << ", cache size: "
+                    << boost::filesystem::file_size(output_file_name) << " bytes" << std::endl;
+    }
+
+}
@@ -0,0 +1,35 @@
+// MDTools
+//     Copyright (C)  2025  Pablo Galaviz
+//
+//     This program is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+//
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+//
+//     You should have received a copy of the GNU General Public License
+//     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//
+// Created by Pablo Galaviz on 16/10/2026.
+//
+
+#ifndef MDTOOLS_MAINCONVERT_H
+#define MDTOOLS_MAINCONVERT_H
+
+#include "parameters.h"
+
+namespace mdtools {
+    /**
+     * Convert the selected frames of the trajectory into a binary trajectory cache (.mdcache) in the
+     * output directory. The cache can be used as io.trajectory_input by any task and is read without parsing.
+     */
+    void mainConvert(const convert_options_t &convert_options, const io_options_t &io_options,
+                     const simulation_options_t &simulation_options);
+}
+
+#endif //MDTOOLS_MAINCONVERT_H
@@ -26,34 +26,32 @@
 
 namespace mdtools {
 
-    void mainPairDistributionHistogram(const pair_distribution_histogram_options_t &pair_distribution_histogram,
-                                       const io_options_t &io_options, simulation_options_t simulation_options) {
-
-        auto trajectory = trajectoryReader(io_options.trajectory_input_file, io_options.coordinates_input_file).get(
-                simulation_options.time_step, simulation_options.start_iteration, simulation_options.delta_iteration,
-                simulation_options.end_iteration);
+    template<class T>
+    static void pairDistributionHistogram(const basic_trajectory_t<T> &trajectory,
+                                          const pair_distribution_histogram_options_t &pair_distribution_histogram,
+                                          const io_options_t &io_options) {
 
         if (trajectory.empty()) {
             LOGGER.error << "PairDistributionHistogram failed" << std::endl;
             return;
         }
 
-        auto number_of_frames = trajectory[0].position_x.size();
+        auto number_of_frames = trajectory.number_of_frames();
         LOGGER.info << "Reading done. Number of frames: " << number_of_frames << std::endl;
-        auto number_of_atoms = trajectory.size();
+        auto number_of_atoms = trajectory.number_of_atoms();
 
         std::map<std::string, boost::histogram::histogram<std::tuple<boost::histogram::axis::regular<double>>>> histograms{};
 
 #pragma omp parallel for
         for (int i = 0; i < number_of_atoms - 1; ++i) {
-            auto &atom_i = trajectory[i];
+            auto type_i = trajectory.atom_type(i);
             for (int j = i + 1; j < number_of_atoms; ++j) {
-                auto &atom_j = trajectory[j];
+                auto type_j = trajectory.atom_type(j);
 
-                std::string key = std::to_string(atom_i.atom_type) + "_" + std::to_string(atom_j.atom_type);
+                std::string key = std::to_string(type_i) + "_" + std::to_string(type_j);
                 auto histogram_iter = histograms.find(key);
 
-                // Construct a new histogram when atom_i.atom_type is not already present
+                // Construct a new histogram when type_i is not already present
 #pragma omp critical
                 {
                     if (histogram_iter == histograms.end()) {
@@ -64,11 +62,11 @@ namespace mdtools {
                     }
                 }
 
-                if (atom_i.atom_type != atom_j.atom_type) { continue; }
+                if (type_i != type_j) { continue; }
 
-                double x = atom_i.mean_position_x - atom_j.mean_position_x;
-                double y = atom_i.mean_position_y - atom_j.mean_position_y;
-                double z = atom_i.mean_position_z - atom_j.mean_position_z;
+                double x = trajectory.mean(field_t::POSITION_X, i) - trajectory.mean(field_t::POSITION_X, j);
+                double y = trajectory.mean(field_t::POSITION_Y, i) - trajectory.mean(field_t::POSITION_Y, j);
+                double z = trajectory.mean(field_t::POSITION_Z, i) - trajectory.mean(field_t::POSITION_Z, j);
                 auto r = sqrt(x * x + y * y + z * z);
 
                 // Use iterator to access histogram
@@ -86,4 +84,23 @@ namespace mdtools {
         }
     }
 
+    void mainPairDistributionHistogram(const pair_distribution_histogram_options_t &pair_distribution_histogram,
+                                       const io_options_t &io_options, simulation_options_t simulation_options) {
+
+        auto reader = trajectoryReader(io_options);
+        reader.readVelocities(false);
+        reader.derive(UNWRAPPED | MEANS);
+        if (simulation_options.precision == "float") {
+            pairDistributionHistogram(reader.get<float>(simulation_options.time_step, simulation_options.start_iteration,
+                                                        simulation_options.delta_iteration,
+                                                        simulation_options.end_iteration),
+                                      pair_distribution_histogram, io_options);
+        } else {
+            pairDistributionHistogram(reader.get<double>(simulation_options.time_step, simulation_options.start_iteration,
+                                                         simulation_options.delta_iteration,
+                                                         simulation_options.end_iteration),
+                                      pair_distribution_histogram, io_options);
+        }
+    }
+
 } // mdtools
\ No newline at end of file
@@ -27,28 +27,22 @@
 namespace mdtools {
 
 
-    void mainPhononDOS(phonon_dos_options_t phonon_dos, const io_options_t &io_options,
-                       const simulation_options_t &simulation_options) {
-
-        LOGGER.info << "main Phonon DOS" << std::endl;
+    template<class T>
+    static void velocityAutocorrelation(const basic_trajectory_t<T> &trajectory) {
 
-        auto trajectory = trajectoryReader(io_options.trajectory_input_file,io_options.coordinates_input_file).get(simulation_options.time_step,
-                                                                                 simulation_options.start_iteration,
-                                                                                 simulation_options.delta_iteration,
-                                                                                 simulation_options.end_iteration);
+        auto n = trajectory.number_of_frames();
 
-        std::valarray<double> vaf = std::valarray<double>(0.0, trajectory[0].velocity_x.size());
-        std::valarray<double> norm = std::valarray<double>(0.0, trajectory[0].velocity_x.size());
+        std::valarray<double> vaf = std::valarray<double>(0.0, n);
+        std::valarray<double> norm = std::valarray<double>(0.0, n);
 
-        auto n = trajectory[0].velocity_x.size();
+        auto inorm = 1.0 / trajectory.number_of_atoms();
 
-        auto inorm = 1.0 / trajectory.size();
-
-        for (auto &item: trajectory) {
+        for (size_t atom_id = 0; atom_id < trajectory.number_of_atoms(); atom_id++) {
+            auto item = trajectory.atom(atom_id);
             for (int i = 0; i < n; i++) {
-                auto vxi = item.velocity_x[i];
-                auto vyi = item.velocity_y[i];
-                auto vzi = item.velocity_z[i];
+                double vxi = item.velocity_x[i];
+                double vyi = item.velocity_y[i];
+                double vzi = item.velocity_z[i];
                 auto in = 1.0 / (n - i);
                 for (int j = i; j < n; j++) {
                     vaf[j] += (vxi * item.velocity_x[j] + vyi * item.velocity_y[j] + vzi * item.velocity_z[j]) * inorm *
@@ -68,6 +62,24 @@ namespace mdtools {
         }
 
         file.close();
+    }
+
+    void mainPhononDOS(phonon_dos_options_t phonon_dos, const io_options_t &io_options,
+                       const simulation_options_t &simulation_options) {
+
+        LOGGER.info << "main Phonon DOS" << std::endl;
+
+        auto reader = trajectoryReader(io_options);
+        reader.derive(VELOCITIES);
+        if (simulation_options.precision == "float") {
+            velocityAutocorrelation(reader.get<float>(simulation_options.time_step, simulation_options.start_iteration,
+                                                      simulation_options.delta_iteration,
+                                                      simulation_options.end_iteration));
+        } else {
+            velocityAutocorrelation(reader.get<double>(simulation_options.time_step, simulation_options.start_iteration,
+                                                       simulation_options.delta_iteration,
+                                                       simulation_options.end_iteration));
+        }
 
         /*
         fftw_complex *in, *out;
@@ -19,6 +19,7 @@
 //
 
 #include "mainRadialDistributionHistogram.h"
+#include "framePipeline.h"
 #include "trajectoryReader.h"
 #include "logger.h"
 #include <boost/histogram.hpp>
@@ -28,68 +29,64 @@ namespace mdtools {
     void mainRadialDistributionHistogram(const radial_distribution_histogram_options_t &radial_distribution_histogram,
                                          const io_options_t &io_options, simulation_options_t simulation_options) {
 
-        auto trajectory = trajectoryReader(io_options.trajectory_input_file, io_options.coordinates_input_file).get(
-                simulation_options.time_step, simulation_options.start_iteration, simulation_options.delta_iteration,
-                simulation_options.end_iteration);
+        auto reader = trajectoryReader(io_options);
+        framePipeline frames(reader, io_options.prefetch_frames);
+        frames.begin(simulation_options.start_iteration, simulation_options.delta_iteration,
+                     simulation_options.end_iteration);
 
-        if (trajectory.empty()) {
+        frame current;
+        if (!frames.next(current)) {
             LOGGER.error << "RadialDistributionHistogram failed" << std::endl;
             return;
         }
 
-        auto number_of_frames = trajectory[0].position_x.size();
-        LOGGER.info << "Reading done. Number of frames: " << number_of_frames << std::endl;
-
         std::map<int, boost::histogram::histogram<std::tuple<boost::histogram::axis::regular<double>>>> histograms{};
 
         auto center = str2center[radial_distribution_histogram.center];
-        double total_mass = 0.0;
-        for (auto &atom: trajectory) {
-            if (histograms.find(atom.atom_type) == histograms.end()) {
-                histograms[atom.atom_type] = boost::histogram::make_histogram(
+        std::valarray<double> mass(current.number_of_atoms);
+        for (size_t atom_id = 0; atom_id < current.number_of_atoms; atom_id++) {
+            auto atom_type = current.atom_type[atom_id];
+            if (histograms.find(atom_type) == histograms.end()) {
+                histograms[atom_type] = boost::histogram::make_histogram(
                         boost::histogram::axis::regular<>(radial_distribution_histogram.size,
                                                           radial_distribution_histogram.start,
                                                           radial_distribution_histogram.stop, "r"));
             }
-            if (simulation_options.mass_map.find(atom.atom_type) == simulation_options.mass_map.end()) {
-                LOGGER.error << "Unknown atom type:" << atom.atom_type << ". Define mass in simulation.atom_mass"
+            if (simulation_options.mass_map.find(atom_type) == simulation_options.mass_map.end()) {
+                LOGGER.error << "Unknown atom type:" << atom_type << ". Define mass in simulation.atom_mass"
                              << std::endl;
                 std::throw_with_nested(std::runtime_error("Fatal error"));
             }
-
-            total_mass += simulation_options.mass_map[atom.atom_type];
+            mass[atom_id] = simulation_options.mass_map[atom_type];
         }
+        double total_mass = mass.sum();
 
         double cx, cy, cz;
-        for (int iteration = 0; iteration < number_of_frames; iteration++) {
+        size_t number_of_frames = 0;
+        do {
 
             if (center == center_t::ORIGIN) {
-                cx = 0.5 * (trajectory[0].lattice_origin_x[iteration] + trajectory[0].lattice_a[iteration]);
-                cy = 0.5 * (trajectory[0].lattice_origin_y[iteration] + trajectory[0].lattice_b[iteration]);
-                cz = 0.5 * (trajectory[0].lattice_origin_z[iteration] + trajectory[0].lattice_c[iteration]);
+                cx = 0.5 * current.lattice[X].maximum;
+                cy = 0.5 * current.lattice[Y].maximum;
+                cz = 0.5 * current.lattice[Z].maximum;
             } else {
-                cx = 0;
-                cy = 0;
-                cz = 0;
-                for (auto &atom: trajectory) {
-                    auto mass = simulation_options.mass_map[atom.atom_type];
-                    cx += mass * atom.position_x[iteration];
-                    cy += mass * atom.position_y[iteration];
-                    cz += mass * atom.position_z[iteration];
-                }
-                cx /= total_mass;
-                cy /= total_mass;
-                cz /= total_mass;
+                cx = (mass * current.position_x).sum() / total_mass;
+                cy = (mass * current.position_y).sum() / total_mass;
+                cz = (mass * current.position_z).sum() / total_mass;
             }
 
-            for (auto &atom: trajectory) {
-                auto x = atom.position_x[iteration] - cx;
-                auto y = atom.position_y[iteration] - cy;
-                auto z = atom.position_z[iteration] - cz;
+            for (size_t atom_id = 0; atom_id < current.number_of_atoms; atom_id++) {
+                auto x = current.position_x[atom_id] - cx;
+                auto y = current.position_y[atom_id] - cy;
+                auto z = current.position_z[atom_id] - cz;
                 auto r = sqrt(x * x + y * y + z * z);
-                histograms[atom.atom_type](r);
+                histograms[current.atom_type[atom_id]](r);
             }
-        }
+            number_of_frames++;
+
+        } while (frames.next(current));
+
+        LOGGER.info << "Reading done. Number of frames: " << number_of_frames << std::endl;
 
         for (auto item: histograms) {
             std::ofstream file;
@@ -19,6 +19,7 @@
 //
 
 #include "mainRadiusOfGyration.h"
+#include "framePipeline.h"
 #include "trajectoryReader.h"
 #include "logger.h"
 #include <gsl/gsl_math.h>
@@ -29,66 +30,52 @@ namespace mdtools {
                               const io_options_t &io_options,
                               simulation_options_t simulation_options) {
 
-        auto trajectory = trajectoryReader(io_options.trajectory_input_file, io_options.coordinates_input_file).get(
-                simulation_options.time_step, simulation_options.start_iteration, simulation_options.delta_iteration,
-                simulation_options.end_iteration);
+        auto reader = trajectoryReader(io_options);
+        framePipeline frames(reader, io_options.prefetch_frames);
+        frames.begin(simulation_options.start_iteration, simulation_options.delta_iteration,
+                     simulation_options.end_iteration);
 
-        if (trajectory.empty()) {
+        frame current;
+        if (!frames.next(current)) {
             LOGGER.error << "RadiusOfGyration failed" << std::endl;
             return;
         }
 
-        auto number_of_frames = trajectory[0].position_x.size();
-        LOGGER.info << "Reading done. Number of frames: " << number_of_frames << std::endl;
-        auto number_of_atoms = trajectory.size();
-
-
-        double total_mass = 0.0;
-        for (auto &atom: trajectory) {
-            if (simulation_options.mass_map.find(atom.atom_type) == simulation_options.mass_map.end()) {
-                LOGGER.error << "Unknown atom type:" << atom.atom_type << ". Define mass in simulation.atom_mass"
+        std::valarray<double> mass(current.number_of_atoms);
+        for (size_t atom_id = 0; atom_id < current.number_of_atoms; atom_id++) {
+            auto atom_type = current.atom_type[atom_id];
+            if (simulation_options.mass_map.find(atom_type) == simulation_options.mass_map.end()) {
+                LOGGER.error << "Unknown atom type:" << atom_type << ". Define mass in simulation.atom_mass"
                              << std::endl;
                 std::throw_with_nested(std::runtime_error("Fatal error"));
             }
-
-            total_mass += simulation_options.mass_map[atom.atom_type];
+            mass[atom_id] = simulation_options.mass_map[atom_type];
         }
+        double total_mass = mass.sum();
 
         std::ofstream file;
         file.open(io_options.output_path + "/rog.csv", std::ios_base::out);
         file << "Time (ps),Radius (nm)" << std::endl;
-        for (int iteration = 0; iteration < number_of_frames; iteration++) {
-            double center_of_mass_x = 0;
-            double center_of_mass_y = 0;
-            double center_of_mass_z = 0;
-            for (auto &atom: trajectory) {
-                auto mass = simulation_options.mass_map[atom.atom_type];
-                center_of_mass_x += mass * atom.position_x[iteration];
-                center_of_mass_y += mass * atom.position_y[iteration];
-                center_of_mass_z += mass * atom.position_z[iteration];
-            }
-
-            center_of_mass_x /= total_mass;
-            center_of_mass_y /= total_mass;
-            center_of_mass_z /= total_mass;
+        size_t number_of_frames = 0;
+        do {
+            double center_of_mass_x = (mass * current.position_x).sum() / total_mass;
+            double center_of_mass_y = (mass * current.position_y).sum() / total_mass;
+            double center_of_mass_z = (mass * current.position_z).sum() / total_mass;
 
             double radius_of_gyrate = 0;
-
-            double max_x = 0;
-            for (auto &atom: trajectory) {
-                auto mass = simulation_options.mass_map[atom.atom_type];
-                radius_of_gyrate += mass * (gsl_pow_2(atom.position_x[iteration] - center_of_mass_x)
-                                            + gsl_pow_2(atom.position_y[iteration] - center_of_mass_y)
-                                            + gsl_pow_2(atom.position_z[iteration] - center_of_mass_z));
-                max_x = std::max(max_x, atom.position_x[iteration]);
+            for (size_t atom_id = 0; atom_id < current.number_of_atoms; atom_id++) {
+                radius_of_gyrate += mass[atom_id] * (gsl_pow_2(current.position_x[atom_id] - center_of_mass_x)
+                                                     + gsl_pow_2(current.position_y[atom_id] - center_of_mass_y)
+                                                     + gsl_pow_2(current.position_z[atom_id] - center_of_mass_z));
             }
             radius_of_gyrate /= total_mass;
 
-            file << trajectory[0].time[iteration] << "," << std::sqrt(radius_of_gyrate) << std::endl;
-//            LOGGER.debug << trajectory[0].time[iteration] << "," << std::sqrt(radius_of_gyrate) << std::endl;
+            file << current.time_step_id * simulation_options.time_step << "," << std::sqrt(radius_of_gyrate) << std::endl;
+            number_of_frames++;
 
-        }
+        } while (frames.next(current));
 
+        LOGGER.info << "Reading done. Number of frames: " << number_of_frames << std::endl;
 
     }
 
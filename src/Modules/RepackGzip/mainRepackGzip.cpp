@@ -0,0 +1,63 @@
+// MDTools
+//     Copyright (C)  2025  Pablo Galaviz
+//
+//     This program is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+//
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+//
+//     You should have received a copy of the GNU General Public License
+//     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//
+// Created by Pablo Galaviz on 16/10/2026.
+//
+
+#include "mainRepackGzip.h"
+#include "bgzf.h"
+#include "logger.h"
+#include <boost/filesystem.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filtering_streambuf.hpp>
+#include <fstream>
+
+namespace mdtools {
+
+    void mainRepackGzip(const repack_gzip_options_t &repack_gzip_options, const io_options_t &io_options) {
+
+        auto input_file_name = io_options.trajectory_input_file;
+        auto input_path = boost::filesystem::path(input_file_name);
+        bool compressed = input_path.extension() == ".gz" || input_path.extension() == ".gzip";
+        auto output_file_name = io_options.output_path + "/" + input_path.filename().string();
+        if (!compressed) { output_file_name += ".gz"; }
+
+        std::ifstream file(input_file_name, std::ios_base::in | std::ios_base::binary);
+        boost::iostreams::filtering_streambuf<boost::iostreams::input> input_buffer;
+        if (compressed) { input_buffer.push(boost::iostreams::gzip_decompressor()); }
+        input_buffer.push(file);
+        std::istream input(&input_buffer);
+
+        std::ofstream output(output_file_name, std::ios_base::out | std::ios_base::binary);
+        if (!output) {
+            LOGGER.error << "Cannot open " << output_file_name << std::endl;
+            return;
+        }
+
+        LOGGER.info << "Repacking " << input_file_name << " into " << output_file_name << std::endl;
+        auto length = bgzf_compress(input, output, repack_gzip_options.level);
+        output.close();
+
+        if (!output) {
+            LOGGER.error << "RepackGzip failed writing " << output_file_name << std::endl;
+            return;
+        }
+        LOGGER.info << "Uncompressed size: " << length << " bytes, compressed size: "
+                    << boost::filesystem::file_size(output_file_name) << " bytes" << std::endl;
+    }
+
+}
@@ -0,0 +1,34 @@
+// MDTools
+//     Copyright (C)  2025  Pablo Galaviz
+//
+//     This program is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+//
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+//
+//     You should have received a copy of the GNU General Public License
+//     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//
+// Created by Pablo Galaviz on 16/10/2026.
+//
+
+#ifndef MDTOOLS_MAINREPACKGZIP_H
+#define MDTOOLS_MAINREPACKGZIP_H
+
+#include "parameters.h"
+
+namespace mdtools {
+    /**
+     * Re-pack a gzip (or uncompressed) trajectory as blocked gzip into the output directory,
+     * so it can be inflated in parallel by the trajectory reader.
+     */
+    void mainRepackGzip(const repack_gzip_options_t &repack_gzip_options, const io_options_t &io_options);
+}
+
+#endif //MDTOOLS_MAINREPACKGZIP_H
@@ -0,0 +1,63 @@
+// MDTools
+//     Copyright (C)  2025  Pablo Galaviz
+//
+//     This program is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+//
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+//
+//     You should have received a copy of the GNU General Public License
+//     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//
+// Created by Pablo Galaviz on 16/10/2026.
+//
+
+#include "atomSelection.h"
+#include "trajectoryReader.h"
+#include <algorithm>
+
+namespace mdtools {
+
+    atomSelection::atomSelection(const io_options_t &io_options) {
+        // The options were checked by io_options_t::validate.
+        types = parse_ranges(io_options.atom_types);
+        ranges = parse_ranges(io_options.atom_indices);
+        if (!io_options.index_group.empty()) {
+            group = read_index_group(io_options.index_file, io_options.index_group);
+            std::sort(group.begin(), group.end());
+            has_group = true;
+        }
+    }
+
+    bool atomSelection::contains(long index, int type) const {
+        auto in = [](const std::vector<std::pair<long, long>> &items, long value) {
+            return items.empty() || std::any_of(items.begin(), items.end(), [value](const std::pair<long, long> &item) {
+                return item.first <= value && value <= item.second;
+            });
+        };
+        return in(types, type) && in(ranges, index) &&
+               (!has_group || std::binary_search(group.begin(), group.end(), index));
+    }
+
+    void atomSelection::compact(frame &current) const {
+        std::valarray<size_t> selected(indices.size());
+        std::copy(indices.begin(), indices.end(), std::begin(selected));
+        current.position_x = std::valarray<double>(current.position_x[selected]);
+        current.position_y = std::valarray<double>(current.position_y[selected]);
+        current.position_z = std::valarray<double>(current.position_z[selected]);
+        current.atom_type = std::valarray<int>(current.atom_type[selected]);
+        if (current.has_velocities()) {
+            current.velocity_x = std::valarray<double>(current.velocity_x[selected]);
+            current.velocity_y = std::valarray<double>(current.velocity_y[selected]);
+            current.velocity_z = std::valarray<double>(current.velocity_z[selected]);
+        }
+        current.number_of_atoms = indices.size();
+    }
+
+}
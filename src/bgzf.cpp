@@ -0,0 +1,247 @@
+// MDTools
+//     Copyright (C)  2025  Pablo Galaviz
+//
+//     This program is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+//
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+//
+//     You should have received a copy of the GNU General Public License
+//     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//
+// Created by Pablo Galaviz on 16/10/2026.
+//
+
+#include "bgzf.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+#include <omp.h>
+#include <zlib.h>
+
+namespace mdtools {
+
+    namespace {
+
+        constexpr size_t header_size = 18;
+        constexpr size_t footer_size = 8;
+        constexpr size_t max_block_size = 0x10000;
+
+        constexpr unsigned char block_header[header_size] = {
+                0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0, 0, 0
+        };
+
+        constexpr unsigned char eof_block[28] = {
+                0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0, 0x1b, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0
+        };
+
+        inline uint32_t read_le32(const unsigned char *p) {
+            return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+        }
+
+        inline void write_le32(unsigned char *p, uint32_t value) {
+            p[0] = value & 0xff;
+            p[1] = (value >> 8) & 0xff;
+            p[2] = (value >> 16) & 0xff;
+            p[3] = (value >> 24) & 0xff;
+        }
+
+        /// Total size of the block starting at p, or 0 if p is not a BGZF block header.
+        size_t block_size(const unsigned char *p, size_t available) {
+            if (available < header_size + footer_size || memcmp(p, block_header, 4) != 0 ||
+                p[10] != 6 || p[11] != 0 || p[12] != 'B' || p[13] != 'C' || p[14] != 2 || p[15] != 0) {
+                return 0;
+            }
+            size_t size = (p[16] | (p[17] << 8)) + 1;
+            return size <= available && size >= header_size + footer_size ? size : 0;
+        }
+
+        struct block_t {
+            size_t compressed_offset;
+            size_t compressed_size;
+            size_t offset;
+            size_t size;
+        };
+
+        /**
+         * Table of the blocks from position on, at most max_blocks of them (all when zero), with their
+         * uncompressed offsets counted from position. Position is moved past the last one.
+         * Throws std::runtime_error on an invalid block header.
+         */
+        std::vector<block_t> read_block_table(const mappedFile &compressed, size_t &position, size_t max_blocks,
+                                              const std::string &file_name) {
+            auto begin = reinterpret_cast<const unsigned char *>(compressed.begin());
+            std::vector<block_t> blocks;
+            size_t offset = 0;
+            while (position < compressed.length() && (max_blocks == 0 || blocks.size() < max_blocks)) {
+                auto compressed_size = block_size(begin + position, compressed.length() - position);
+                auto length = compressed_size > 0 ? read_le32(begin + position + compressed_size - 4) : 0;
+                if (compressed_size == 0 || length > max_block_size) {
+                    throw std::runtime_error("Invalid BGZF block at byte " + std::to_string(position) + " of " +
+                                             file_name);
+                }
+                blocks.push_back({position, compressed_size, offset, length});
+                offset += length;
+                position += compressed_size;
+            }
+            return blocks;
+        }
+
+        /// Inflate blocks in parallel into output at their offsets, checking their CRC32 (std::runtime_error).
+        void inflate_blocks(const mappedFile &compressed, const std::vector<block_t> &blocks, char *output,
+                            const std::string &file_name) {
+            auto begin = reinterpret_cast<const unsigned char *>(compressed.begin());
+            // First corrupted block, reported once the workers are done.
+            auto corrupted = blocks.size();
+#pragma omp parallel
+            {
+                z_stream stream{};
+                inflateInit2(&stream, -MAX_WBITS);
+#pragma omp for schedule(dynamic, 16)
+                for (size_t i = 0; i < blocks.size(); i++) {
+                    auto &block = blocks[i];
+                    auto block_output = reinterpret_cast<Bytef *>(output + block.offset);
+                    inflateReset(&stream);
+                    stream.next_in = const_cast<Bytef *>(begin + block.compressed_offset + header_size);
+                    stream.avail_in = static_cast<uInt>(block.compressed_size - header_size - footer_size);
+                    stream.next_out = block_output;
+                    stream.avail_out = static_cast<uInt>(block.size);
+                    auto status = inflate(&stream, Z_FINISH);
+                    auto crc = read_le32(begin + block.compressed_offset + block.compressed_size - 8);
+                    if ((status != Z_STREAM_END && block.size > 0) || stream.total_out != block.size ||
+                        crc32(0L, block_output, static_cast<uInt>(block.size)) != crc) {
+#pragma omp critical
+                        corrupted = std::min(corrupted, i);
+                    }
+                }
+                inflateEnd(&stream);
+            }
+            if (corrupted < blocks.size()) {
+                throw std::runtime_error("Corrupted BGZF block at byte " +
+                                         std::to_string(blocks[corrupted].compressed_offset) + " of " + file_name);
+            }
+        }
+
+        /// Compress one block of data into block, returns the block size.
+        size_t compress_block(z_stream &stream, const char *data, size_t length, unsigned char *block, int level) {
+            memcpy(block, block_header, header_size);
+            deflateReset(&stream);
+            deflateParams(&stream, level, Z_DEFAULT_STRATEGY);
+            stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+            stream.avail_in = static_cast<uInt>(length);
+            stream.next_out = block + header_size;
+            stream.avail_out = static_cast<uInt>(max_block_size - header_size - footer_size);
+            if (deflate(&stream, Z_FINISH) != Z_STREAM_END) {
+                // Incompressible data, store it (always fits for bgzf_block_data_size bytes).
+                return compress_block(stream, data, length, block, 0);
+            }
+            size_t size = header_size + stream.total_out + footer_size;
+            block[16] = (size - 1) & 0xff;
+            block[17] = ((size - 1) >> 8) & 0xff;
+            write_le32(block + size - 8, crc32(0L, reinterpret_cast<const Bytef *>(data), static_cast<uInt>(length)));
+            write_le32(block + size - 4, static_cast<uint32_t>(length));
+            return size;
+        }
+
+    }
+
+    bool is_bgzf(const std::string &file_name) {
+        std::ifstream file(file_name, std::ios_base::in | std::ios_base::binary);
+        unsigned char header[header_size + footer_size];
+        if (!file.read(reinterpret_cast<char *>(header), sizeof(header))) {
+            return false;
+        }
+        return block_size(header, std::numeric_limits<size_t>::max()) != 0;
+    }
+
+    bgzfFile::bgzfFile(const std::string &file_name) {
+
+        mappedFile compressed(file_name);
+        try {
+            size_t position = 0;
+            auto blocks = read_block_table(compressed, position, 0, file_name);
+            size_t length = blocks.empty() ? 0 : blocks.back().offset + blocks.back().size;
+            LOGGER.debug << "BGZF blocks: " << blocks.size() << ", uncompressed size: " << length << std::endl;
+
+            allocate(length);
+            inflate_blocks(compressed, blocks, data, file_name);
+        }
+        catch (const std::runtime_error &error) {
+            LOGGER.error << error.what() << std::endl;
+            exit(EIO);
+        }
+        madvise(data, size, MADV_SEQUENTIAL);
+    }
+
+    bgzfStreambuf::bgzfStreambuf(const std::string &file_name) : file_name(file_name), compressed(file_name),
+                                                                 batch_blocks(16 * static_cast<size_t>(omp_get_max_threads())),
+                                                                 buffer(batch_blocks * max_block_size) {
+        setg(buffer.data(), buffer.data(), buffer.data());
+    }
+
+    bgzfStreambuf::int_type bgzfStreambuf::underflow() {
+        if (gptr() < egptr()) {
+            return traits_type::to_int_type(*gptr());
+        }
+        // Empty blocks (the end of file marker) are skipped.
+        size_t length = 0;
+        while (length == 0 && position < compressed.length()) {
+            auto blocks = read_block_table(compressed, position, batch_blocks, file_name);
+            inflate_blocks(compressed, blocks, buffer.data(), file_name);
+            length = blocks.back().offset + blocks.back().size;
+        }
+        // The compressed blocks already inflated are not read again.
+        compressed.release(released, position);
+        released = position;
+        setg(buffer.data(), buffer.data(), buffer.data() + length);
+        return length > 0 ? traits_type::to_int_type(*gptr()) : traits_type::eof();
+    }
+
+    size_t bgzf_compress(std::istream &input, std::ostream &output, int level) {
+
+        const size_t batch = 16 * static_cast<size_t>(omp_get_max_threads());
+        std::vector<char> buffer(batch * bgzf_block_data_size);
+        std::vector<unsigned char> blocks(batch * max_block_size);
+        std::vector<size_t> block_sizes(batch);
+        size_t total = 0;
+
+        while (input) {
+            input.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            auto length = static_cast<size_t>(input.gcount());
+            if (length == 0) {
+                break;
+            }
+            auto n = (length + bgzf_block_data_size - 1) / bgzf_block_data_size;
+#pragma omp parallel
+            {
+                z_stream stream{};
+                deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+#pragma omp for schedule(dynamic)
+                for (size_t i = 0; i < n; i++) {
+                    auto block_length = std::min(bgzf_block_data_size, length - i * bgzf_block_data_size);
+                    block_sizes[i] = compress_block(stream, buffer.data() + i * bgzf_block_data_size, block_length,
+                                                    blocks.data() + i * max_block_size, level);
+                }
+                deflateEnd(&stream);
+            }
+            for (size_t i = 0; i < n; i++) {
+                output.write(reinterpret_cast<const char *>(blocks.data() + i * max_block_size),
+                             static_cast<std::streamsize>(block_sizes[i]));
+            }
+            total += length;
+        }
+        output.write(reinterpret_cast<const char *>(eof_block), sizeof(eof_block));
+
+        return total;
+    }
+
+}
@@ -0,0 +1,105 @@
+// MDTools
+//     Copyright (C)  2025  Pablo Galaviz
+//
+//     This program is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+//
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+//
+//     You should have received a copy of the GNU General Public License
+//     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//
+// Created by Pablo Galaviz on 16/10/2026.
+//
+
+#include "frameIndex.h"
+#include "logger.h"
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+
+namespace mdtools {
+
+    namespace {
+        constexpr char index_magic[8] = {'M', 'D', 'T', 'I', 'D', 'X', '1', '\0'};
+
+        struct index_header_t {
+            char magic[8];
+            uint64_t file_size;
+            int64_t file_mtime;
+            uint64_t number_of_frames;
+        };
+    }
+
+    frameIndex::frameIndex(const std::string &file_name) : trajectory_file_name(file_name) {
+        struct stat file_stat{};
+        if (stat(file_name.c_str(), &file_stat) == 0) {
+            file_size = static_cast<uint64_t>(file_stat.st_size);
+            file_mtime = static_cast<int64_t>(file_stat.st_mtim.tv_sec) * 1000000000 + file_stat.st_mtim.tv_nsec;
+        }
+    }
+
+    bool frameIndex::load(uint64_t data_size) {
+        std::ifstream file(sidecar(), std::ios_base::in | std::ios_base::binary | std::ios_base::ate);
+        if (!file) {
+            return false;
+        }
+        auto sidecar_size = static_cast<uint64_t>(file.tellg());
+        file.seekg(0);
+        index_header_t header{};
+        if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+            memcmp(header.magic, index_magic, sizeof(index_magic)) != 0) {
+            LOGGER.warning << "Ignoring invalid frame index " << sidecar() << std::endl;
+            return false;
+        }
+        if (header.file_size != file_size || header.file_mtime != file_mtime) {
+            LOGGER.info << "Frame index " << sidecar() << " is out of date" << std::endl;
+            return false;
+        }
+        // The number of frames is checked against the sidecar size before anything is allocated for them.
+        if ((sidecar_size - sizeof(header)) / sizeof(frame_index_entry_t) != header.number_of_frames ||
+            (sidecar_size - sizeof(header)) % sizeof(frame_index_entry_t) != 0) {
+            LOGGER.warning << "Ignoring truncated frame index " << sidecar() << std::endl;
+            return false;
+        }
+        frames.resize(header.number_of_frames);
+        if (!file.read(reinterpret_cast<char *>(frames.data()),
+                       static_cast<std::streamsize>(frames.size() * sizeof(frame_index_entry_t)))) {
+            LOGGER.warning << "Ignoring truncated frame index " << sidecar() << std::endl;
+            frames.clear();
+            return false;
+        }
+        // Frames are read straight from their offsets, which have to be increasing and inside the data.
+        for (size_t i = 0; i < frames.size(); i++) {
+            if (frames[i].offset >= data_size || (i > 0 && frames[i].offset <= frames[i - 1].offset)) {
+                LOGGER.warning << "Ignoring invalid frame index " << sidecar() << std::endl;
+                frames.clear();
+                return false;
+            }
+        }
+        LOGGER.debug << "Frame index " << sidecar() << " loaded, number of frames: " << frames.size() << std::endl;
+        return true;
+    }
+
+    void frameIndex::save() const {
+        std::ofstream file(sidecar(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+        index_header_t header{};
+        memcpy(header.magic, index_magic, sizeof(index_magic));
+        header.file_size = file_size;
+        header.file_mtime = file_mtime;
+        header.number_of_frames = frames.size();
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(frames.data()),
+                   static_cast<std::streamsize>(frames.size() * sizeof(frame_index_entry_t)));
+        if (!file) {
+            LOGGER.warning << "Cannot write frame index " << sidecar() << std::endl;
+        }
+    }
+
+}
@@ -0,0 +1,104 @@
+// MDTools
+//     Copyright (C)  2025  Pablo Galaviz
+//
+//     This program is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+//
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+//
+//     You should have received a copy of the GNU General Public License
+//     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//
+// Created by Pablo Galaviz on 16/10/2026.
+//
+
+#include "framePipeline.h"
+
+namespace mdtools {
+
+    framePipeline::framePipeline(trajectoryReader &reader, size_t number_of_buffers) : reader(reader),
+                                                                                        ring(number_of_buffers) {
+    }
+
+    framePipeline::~framePipeline() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        slot_free.notify_all();
+        if (producer.joinable()) {
+            producer.join();
+        }
+    }
+
+    void framePipeline::begin(int start_iteration, int delta_iteration, int end_iteration) {
+        reader.begin(start_iteration, delta_iteration, end_iteration);
+        if (!ring.empty()) {
+            producer = std::thread(&framePipeline::produce, this);
+        }
+    }
+
+    void framePipeline::produce() {
+        while (true) {
+            size_t slot;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                slot_free.wait(lock, [this] { return count < ring.size() || stopping; });
+                if (stopping) {
+                    break;
+                }
+                slot = (head + count) % ring.size();
+            }
+            // The slot is not visible to the consumer until count is increased, it is filled without the lock.
+            bool read = false;
+            std::exception_ptr thrown;
+            try {
+                read = reader.next(ring[slot]);
+            }
+            catch (...) {
+                thrown = std::current_exception();
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (read) {
+                    count++;
+                } else {
+                    finished = true;
+                    error = thrown;
+                }
+            }
+            frame_ready.notify_one();
+            if (!read) {
+                break;
+            }
+        }
+    }
+
+    bool framePipeline::next(frame &current) {
+        if (ring.empty()) {
+            return reader.next(current);
+        }
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            frame_ready.wait(lock, [this] { return count > 0 || finished; });
+            if (count == 0) {
+                if (error) {
+                    std::rethrow_exception(error);
+                }
+                return false;
+            }
+            std::swap(current, ring[head]);
+            head = (head + 1) % ring.size();
+            count--;
+        }
+        slot_free.notify_one();
+        return true;
+    }
+
+} // mdtools
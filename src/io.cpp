@@ -19,6 +19,8 @@
 //
 
 #include "io.h"
+#include "trajectoryArena.h"
+#include <sys/resource.h>
 
 namespace mdtools {
 
@@ -79,6 +81,75 @@ namespace mdtools {
         LOGGER.info << "" << std::endl;
     }
 
+/**
+ * Parse a list of numbers and inclusive ranges
+ * @param input comma separated items, e.g. "1-100,250"
+ * @return the [first, last] pair of every item
+ */
+    std::vector<std::pair<long, long>> parse_ranges(const std::string &input) {
+        std::vector<std::string> items;
+        boost::algorithm::split(items, input, boost::is_any_of(","));
+        std::vector<std::pair<long, long>> result;
+        for (auto &item: items) {
+            boost::algorithm::trim(item);
+            if (item.empty()) {
+                continue;
+            }
+            // The dash of a range is searched after the first character, so that "-1" is reported as invalid.
+            auto dash = item.find('-', 1);
+            auto first = boost::algorithm::trim_copy(item.substr(0, dash));
+            auto last = dash == std::string::npos ? first : boost::algorithm::trim_copy(item.substr(dash + 1));
+            size_t first_size = 0, last_size = 0;
+            long a = 0, b = 0;
+            try {
+                a = std::stol(first, &first_size);
+                b = std::stol(last, &last_size);
+            }
+            catch (std::exception &) {
+                first_size = 0;
+            }
+            if (first_size != first.size() || last_size != last.size() || a < 1 || b < a) {
+                throw std::runtime_error("Invalid range: " + item + " (expecting positive numbers or first-last)");
+            }
+            result.emplace_back(a, b);
+        }
+        return result;
+    }
+
+/**
+ * Read a group of a gromacs index file
+ * @param file_name the .ndx file, groups start with a "[ name ]" line followed by the 1-based atom indices
+ * @param group name of the group
+ * @return the atom indices of the group
+ */
+    std::vector<long> read_index_group(const std::string &file_name, const std::string &group) {
+        auto file = open_file(file_name, "Index file is missing");
+        std::vector<long> result;
+        bool found = false, reading = false;
+        std::string line;
+        while (std::getline(file, line)) {
+            boost::algorithm::trim(line);
+            if (!line.empty() && line.front() == '[') {
+                if (found) {
+                    break;
+                }
+                reading = boost::algorithm::trim_copy(line.substr(1, line.find(']') - 1)) == group;
+                found = reading;
+                continue;
+            }
+            if (!reading) {
+                continue;
+            }
+            std::istringstream values(line);
+            long index;
+            while (values >> index) { result.push_back(index); }
+        }
+        if (!found) {
+            throw std::runtime_error("No group [ " + group + " ] in index file " + file_name);
+        }
+        return result;
+    }
+
 /**
  * Returns a string in time format
  * @param value time in specified units
@@ -124,6 +195,12 @@ namespace mdtools {
                     << get_time_str(seconds, "second")
                     << milliseconds << " milliseconds " << std::endl;
 
+        trajectoryArena::getInstance().logSummary();
+        struct rusage usage{};
+        if (getrusage(RUSAGE_SELF, &usage) == 0) {
+            LOGGER.info << "Page faults: " << usage.ru_minflt << " minor, " << usage.ru_majflt << " major" << std::endl;
+        }
+
         LOGGER.info << "All done! " << std::endl;
 
     }
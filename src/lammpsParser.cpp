@@ -0,0 +1,304 @@
+// MDTools
+//     Copyright (C)  2025  Pablo Galaviz
+//
+//     This program is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+//
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+//
+//     You should have received a copy of the GNU General Public License
+//     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//
+// Created by Pablo Galaviz on 16/10/2026.
+//
+
+#include "lammpsParser.h"
+#include <algorithm>
+
+namespace mdtools {
+
+    const char *find_lammps_item(const char *position, const char *end, std::string_view item) {
+        while (position < end) {
+            if (static_cast<size_t>(end - position) >= item.size() &&
+                memcmp(position, item.data(), item.size()) == 0) {
+                return position;
+            }
+            position = next_line(position, end);
+        }
+        return end;
+    }
+
+    bool report_frame_status(const frame_status_t &status, int time_step_id, int number_of_atoms) {
+        for (auto item: status.unknown_items) {
+            LOGGER.info << item << std::endl;
+        }
+        for (auto line: status.invalid_lines) {
+            LOGGER.warning << line << std::endl;
+        }
+        if (status.inconsistent) {
+            LOGGER.warning << "Inconsistent number of atoms at frame:" << time_step_id << std::endl;
+            LOGGER.warning << "Found:" << status.found_atoms << " expecting:" << number_of_atoms << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    std::vector<const char *> find_lammps_frames(const char *position, const char *end) {
+        constexpr std::string_view item = "ITEM: TIMESTEP";
+        std::vector<const char *> frames;
+        auto begin = position;
+        while (position < end) {
+            auto found = static_cast<const char *>(memmem(position, end - position, item.data(), item.size()));
+            if (found == nullptr) {
+                break;
+            }
+            if (found == begin || found[-1] == '\n') {
+                frames.push_back(found);
+            }
+            position = found + item.size();
+        }
+        return frames;
+    }
+
+    std::vector<frame_index_entry_t> index_lammps_frames(const char *begin, const char *end) {
+        auto frames = find_lammps_frames(begin, end);
+        std::vector<frame_index_entry_t> entries(frames.size());
+#pragma omp parallel for
+        for (size_t i = 0; i < frames.size(); i++) {
+            auto frame_end = i + 1 < frames.size() ? frames[i + 1] : end;
+            entries[i].offset = frames[i] - begin;
+            parse_number(next_line(frames[i], frame_end), frame_end, entries[i].time_step_id);
+            auto position = find_lammps_item(frames[i], frame_end, "ITEM: NUMBER OF ATOMS");
+            if (position != frame_end) {
+                parse_number(next_line(position, frame_end), frame_end, entries[i].number_of_atoms);
+            }
+        }
+        return entries;
+    }
+
+    bool parse_lammps_columns(std::string_view header, lammps_columns_t &columns) {
+        // Names after "ITEM: ATOMS"
+        std::vector<std::string_view> names;
+        auto end = header.data() + header.size();
+        auto item = header.find("ATOMS");
+        auto position = item == std::string_view::npos ? end : header.data() + item + 5;
+        while (auto token_end = skip_token(position, end)) {
+            while (*position == ' ' || *position == '\t') { position++; }
+            names.emplace_back(position, token_end - position);
+            position = token_end;
+        }
+        if (names.empty()) {
+            columns.resolved = true;
+            return true;
+        }
+
+        auto find = [&names](std::string_view name) {
+            return static_cast<int>(std::find(names.begin(), names.end(), name) - names.begin());
+        };
+        auto found = [&names](int column) { return column < static_cast<int>(names.size()); };
+        int id = find("id");
+        if (!found(id)) {
+            return false;
+        }
+        std::vector<lammps_column_t> roles(names.size(), lammps_column_t::SKIP);
+        roles[id] = lammps_column_t::ID;
+        if (found(find("type"))) { roles[find("type")] = lammps_column_t::TYPE; }
+
+        // Preferred position columns first, each set has to be complete.
+        struct position_columns_t {
+            const char *names[3];
+            bool scaled;
+            bool unwrapped;
+        };
+        constexpr position_columns_t candidates[] = {{{"xu",  "yu",  "zu"},  false, true},
+                                                     {{"xsu", "ysu", "zsu"}, true,  true},
+                                                     {{"xs",  "ys",  "zs"},  true,  false},
+                                                     {{"x",   "y",   "z"},   false, false}};
+        bool has_positions = false;
+        for (auto &candidate: candidates) {
+            if (found(find(candidate.names[0])) && found(find(candidate.names[1])) && found(find(candidate.names[2]))) {
+                roles[find(candidate.names[0])] = lammps_column_t::X;
+                roles[find(candidate.names[1])] = lammps_column_t::Y;
+                roles[find(candidate.names[2])] = lammps_column_t::Z;
+                columns.scaled = candidate.scaled;
+                columns.unwrapped = candidate.unwrapped;
+                has_positions = true;
+                break;
+            }
+        }
+        if (!has_positions) {
+            return false;
+        }
+        columns.velocities = found(find("vx")) && found(find("vy")) && found(find("vz"));
+        if (columns.velocities) {
+            roles[find("vx")] = lammps_column_t::VX;
+            roles[find("vy")] = lammps_column_t::VY;
+            roles[find("vz")] = lammps_column_t::VZ;
+        }
+
+        // Columns after the last one used are not tokenized.
+        while (roles.back() == lammps_column_t::SKIP) { roles.pop_back(); }
+        columns.roles = roles;
+        columns.resolved = true;
+        return true;
+    }
+
+    lammps_columns_t find_lammps_columns(const char *position, const char *end) {
+        lammps_columns_t columns;
+        position = find_lammps_item(position, end, "ITEM: ATOMS");
+        if (position != end) {
+            auto header = line_view(position, next_line(position, end));
+            if (!parse_lammps_columns(header, columns)) {
+                LOGGER.warning << "Unknown lammps columns, reading id type xs ys zs: " << header << std::endl;
+                columns = lammps_columns_t();
+            }
+        }
+        columns.resolved = true;
+        return columns;
+    }
+
+    bool parse_lammps_atom(const char *position, const char *line_end, const lammps_columns_t &columns,
+                           frame &current, int number_of_atoms, const atomSelection *selection) {
+        long id = -1;
+        long slot = -1;
+        int atom_type = 0;
+        double values[6] = {0, 0, 0, 0, 0, 0};
+        for (auto role: columns.roles) {
+            switch (role) {
+                case lammps_column_t::SKIP:
+                    position = skip_token(position, line_end);
+                    break;
+                case lammps_column_t::ID:
+                    position = parse_number(position, line_end, id);
+                    id--;
+                    slot = selection ? selection->slot(id) : id;
+                    // Unselected atoms are skipped before converting the rest of the line.
+                    if (position && slot < 0 && id >= 0 && id < number_of_atoms) {
+                        return true;
+                    }
+                    break;
+                case lammps_column_t::TYPE:
+                    position = parse_number(position, line_end, atom_type);
+                    break;
+                default:
+                    position = parse_number(position, line_end,
+                                            values[static_cast<int>(role) - static_cast<int>(lammps_column_t::X)]);
+            }
+            if (position == nullptr) {
+                return false;
+            }
+        }
+        if (slot < 0 || slot >= static_cast<long>(current.number_of_atoms)) {
+            return false;
+        }
+
+        current.atom_type[slot] = atom_type;
+        if (columns.scaled == !columns.unwrapped) {
+            // Wrapped fractions (xs), or continuous positions in nm (xu)
+            double scale = columns.scaled ? 1 : 0.1;
+            current.position_x[slot] = values[X] * scale;
+            current.position_y[slot] = values[Y] * scale;
+            current.position_z[slot] = values[Z] * scale;
+        } else {
+            // Continuous fractions (xsu) are converted to nm, wrapped positions (x) in Angstrom to fractions.
+            std::valarray<double> *positions[3] = {&current.position_x, &current.position_y, &current.position_z};
+            for (int c = X; c <= Z; c++) {
+                auto minimum = current.lattice[c].minimum;
+                auto length = current.lattice[c].maximum - minimum;
+                (*positions[c])[slot] = columns.scaled ? minimum + length * values[c] : (values[c] / 10 - minimum) / length;
+            }
+        }
+        if (columns.velocities) {
+            current.velocity_x[slot] = values[3] * columns.velocity_scale;
+            current.velocity_y[slot] = values[4] * columns.velocity_scale;
+            current.velocity_z[slot] = values[5] * columns.velocity_scale;
+        }
+        return true;
+    }
+
+    const char *parse_lammps_frame(const char *position, const char *end, frame &current, int &number_of_atoms,
+                                   bool skip, const lammps_columns_t &columns, frame_status_t &status,
+                                   const atomSelection *selection) {
+
+        status.clear();
+        position = find_lammps_item(position, end, "ITEM: TIMESTEP");
+        if (position == end) {
+            return nullptr;
+        }
+        position = next_line(position, end);
+        if (!parse_number(position, end, current.time_step_id)) {
+            return nullptr;
+        }
+        position = next_line(position, end);
+        current.scaled = !columns.unwrapped;
+        current.unwrapped = columns.unwrapped;
+
+        while (position < end) {
+            auto line_end = next_line(position, end);
+            std::string_view line(position, line_end - position);
+            if (line.compare(0, 5, "ITEM:") != 0) {
+                position = line_end;
+                continue;
+            }
+            if (line.find("NUMBER OF ATOMS") != std::string_view::npos) {
+                position = line_end;
+                int noa = 0;
+                if (!parse_number(position, end, noa)) {
+                    return nullptr;
+                }
+                if (number_of_atoms == 0) {
+                    number_of_atoms = noa;
+                } else {
+                    if (number_of_atoms != noa) {
+                        status.inconsistent = true;
+                        status.found_atoms = noa;
+                        return nullptr;
+                    }
+                }
+                current.resize(selection ? selection->size(number_of_atoms) : number_of_atoms);
+                position = next_line(position, end);
+                continue;
+            }
+            if (line.find("BOX BOUNDS") != std::string_view::npos) {
+                position = line_end;
+                for (auto &bounds: current.lattice) {
+                    auto next = parse_number(position, end, bounds.minimum);
+                    if (!next || !parse_number(next, end, bounds.maximum)) {
+                        return nullptr;
+                    }
+                    bounds.minimum /= 10;
+                    bounds.maximum /= 10;
+                    position = next_line(position, end);
+                }
+                continue;
+            }
+            if (line.find("ATOMS") != std::string_view::npos) {
+                position = line_end;
+                if (!skip) {
+                    current.resize_velocities(columns.velocities);
+                }
+                int i = 0;
+                for (; i < number_of_atoms && position < end; i++) {
+                    line_end = next_line(position, end);
+                    if (!skip && !parse_lammps_atom(position, line_end, columns, current, number_of_atoms, selection)) {
+                        status.invalid_lines.push_back(line_view(position, line_end));
+                    }
+                    position = line_end;
+                }
+                // The file ends inside the atom section (e.g. a dump still being written).
+                return i == number_of_atoms ? position : nullptr;
+            }
+            status.unknown_items.push_back(line_view(position, line_end));
+            position = line_end;
+        }
+
+        return nullptr;
+    }
+
+}
@@ -17,12 +17,15 @@
 #include <iostream>
 #include "io.h"
 #include "parameters.h"
+#include "trajectoryArena.h"
 #include "Modules/DynamicStructureFactor/mainDynamicStructureFactor.h"
 #include "Modules/PhononDOS/mainPhononDOS.h"
 #include "Modules/AxialDistributionHistogram/mainAxialDistributionHistogram.h"
 #include "Modules/RadialDistributionHistogram/mainRadialDistributionHistogram.h"
 #include "Modules/PairDistributionHistogram/mainPairDistributionHistogram.h"
 #include "Modules/RadiusOfGyration/mainRadiusOfGyration.h"
+#include "Modules/RepackGzip/mainRepackGzip.h"
+#include "Modules/Convert/mainConvert.h"
 
 int main(const int ac, char *av[]) {
 
@@ -56,9 +59,27 @@ int main(const int ac, char *av[]) {
                 ("io.output",
                  boost::program_options::value<std::string>(&io_options.output_path)->default_value("output"), "")
                 ("io.trajectory_input",
-                 boost::program_options::value<std::string>(&io_options.trajectory_input_file)->default_value("dump.lammpstrj"), "Trajectory file in lammps or gromacs (trr,xtc) format")
+                 boost::program_options::value<std::string>(&io_options.trajectory_input_file)->default_value("dump.lammpstrj"), "Trajectory file in lammps, gromacs (trr,xtc) or vasp (XDATCAR) format. Restarted runs can be given as a comma separated list or glob of segments, e.g. dump.*.lammpstrj.gz")
                 ("io.coordinate_input",
-                 boost::program_options::value<std::string>(&io_options.coordinates_input_file)->default_value("input.gro"), "Coordinate file gro format (mandatory for gromacs trajectory)");
+                 boost::program_options::value<std::string>(&io_options.coordinates_input_file)->default_value("input.gro"), "Coordinate file gro format (mandatory for gromacs trajectory)")
+                ("io.lammps_parser",
+                 boost::program_options::value<std::string>(&io_options.lammps_parser)->default_value("mmap"), "Parser for uncompressed lammps dumps. Possible options [mmap,stream]")
+                ("io.lammps_units",
+                 boost::program_options::value<std::string>(&io_options.lammps_units)->default_value("real"), "Units of the velocities dumped by lammps (vx vy vz), real (Angstrom/fs) or metal (Angstrom/ps). Possible options [real,metal]")
+                ("io.frame_index",
+                 boost::program_options::value<bool>(&io_options.frame_index)->default_value(false), "Build (on first read) and use a <trajectory>.idx file with the frame offsets of uncompressed lammps dumps")
+                ("io.xtc_decoder",
+                 boost::program_options::value<std::string>(&io_options.xtc_decoder)->default_value("fast"), "XTC coordinate decoder. Possible options [fast,reference]")
+                ("io.prefetch_frames",
+                 boost::program_options::value<int>(&io_options.prefetch_frames)->default_value(4), "Frames decoded ahead by a reader thread while the previous ones are analysed (0 reads on the analysis thread)")
+                ("io.atom_types",
+                 boost::program_options::value<std::string>(&io_options.atom_types)->default_value(""), "Read only atoms of these types, e.g. 1,3-4 (empty reads all)")
+                ("io.atom_indices",
+                 boost::program_options::value<std::string>(&io_options.atom_indices)->default_value(""), "Read only atoms with these 1-based indices, e.g. 1-1000,2001 (empty reads all)")
+                ("io.index_file",
+                 boost::program_options::value<std::string>(&io_options.index_file)->default_value(""), "Gromacs index file (.ndx) with the group in io.index_group")
+                ("io.index_group",
+                 boost::program_options::value<std::string>(&io_options.index_group)->default_value(""), "Read only atoms of this group of io.index_file. Combined with io.atom_types and io.atom_indices, an atom has to match all of them");
 
 
         mdtools::simulation_options_t simulation_options;
@@ -68,7 +89,9 @@ int main(const int ac, char *av[]) {
                 ("simulation.time_step",boost::program_options::value<double>(&simulation_options.time_step)->default_value(1), "Simulation time step in fs")
                 ("simulation.start_iteration",boost::program_options::value<int>(&simulation_options.start_iteration)->default_value(0), "Read from start iteration")
                 ("simulation.delta_iteration",boost::program_options::value<int>(&simulation_options.delta_iteration)->default_value(1), "Read every delta iterations")
-                ("simulation.end_iteration",boost::program_options::value<int>(&simulation_options.end_iteration)->default_value(0), "Read until end iteration. If end_iteration <= start_iteration read all.");
+                ("simulation.end_iteration",boost::program_options::value<int>(&simulation_options.end_iteration)->default_value(0), "Read until end iteration. If end_iteration <= start_iteration read all.")
+                ("simulation.precision",boost::program_options::value<std::string>(&simulation_options.precision)->default_value("double"), "Storage precision of the trajectory, float halves the memory (reductions still accumulate in double). Possible options [float,double]")
+                ("simulation.allocator",boost::program_options::value<std::string>(&simulation_options.allocator)->default_value("arena"), "Allocator of the trajectory storage: arena reserves one region backed by huge pages and first touches it in parallel, malloc to compare against. Possible options [arena,malloc]");
 
 
         mdtools::phonon_dos_options_t phonon_dos;
@@ -126,6 +149,18 @@ int main(const int ac, char *av[]) {
                  ("radius_of_gyration.atom_type_mass_json",
                 boost::program_options::value<std::string>(&radius_of_gyration_options.atom_type_mass_json)->default_value(""), "Set a json map of type and mass");
 
+        mdtools::repack_gzip_options_t repack_gzip_options;
+        boost::program_options::options_description repackGzipOptions("Repack Gzip Options");
+        repackGzipOptions.add_options()
+                ("repack_gzip.level",
+                 boost::program_options::value<int>(&repack_gzip_options.level)->default_value(6), "Compression level [0-9] of the blocked gzip output");
+
+        mdtools::convert_options_t convert_options;
+        boost::program_options::options_description convertOptions("Convert Options");
+        convertOptions.add_options()
+                ("convert.precision",
+                 boost::program_options::value<std::string>(&convert_options.precision)->default_value("double"), "Precision of the positions in the trajectory cache. Possible options [float,double]");
+
         boost::program_options::positional_options_description positional;
         positional.add("task", 1);
 
@@ -138,6 +173,8 @@ int main(const int ac, char *av[]) {
                 .add(axialDistributionHistogramOptions)
                 .add(radialDistributionHistogramOptions)
                 .add(pairDistributionHistogramOptions)
+                .add(repackGzipOptions)
+                .add(convertOptions)
                 ;
 
         boost::program_options::options_description configFileOptions;
@@ -148,6 +185,8 @@ int main(const int ac, char *av[]) {
                 .add(axialDistributionHistogramOptions)
                 .add(radialDistributionHistogramOptions)
                 .add(pairDistributionHistogramOptions)
+                .add(repackGzipOptions)
+                .add(convertOptions)
                 ;
 
         boost::program_options::variables_map vm;
@@ -192,6 +231,8 @@ int main(const int ac, char *av[]) {
 
         io_options.validate();
         simulation_options.validate();
+        mdtools::trajectoryArena::getInstance().use(simulation_options.allocator == "malloc" ? mdtools::allocator_t::MALLOC
+                                                                                            : mdtools::allocator_t::ARENA);
         switch (mdtools::str2task.at(task)) {
 
             case mdtools::task_t::PhononDOS :
@@ -218,6 +259,14 @@ int main(const int ac, char *av[]) {
             case mdtools::task_t::RadiusOfGyration:
                 mdtools::mainRadiusOfGyration(radius_of_gyration_options,io_options,simulation_options);
                 break;
+            case mdtools::task_t::RepackGzip:
+                repack_gzip_options.validate();
+                mdtools::mainRepackGzip(repack_gzip_options,io_options);
+                break;
+            case mdtools::task_t::Convert:
+                convert_options.validate();
+                mdtools::mainConvert(convert_options,io_options,simulation_options);
+                break;
             default:
                 mdtools::LOGGER.error << "Unknown task: " << task << std::endl;
                 mdtools::LOGGER.error << "Valid options are: " << std::endl;
@@ -0,0 +1,168 @@
+// MDTools
+//     Copyright (C)  2025  Pablo Galaviz
+//
+//     This program is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+//
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+//
+//     You should have received a copy of the GNU General Public License
+//     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//
+// Created by Pablo Galaviz on 16/10/2026.
+//
+
+#include "trajectoryArena.h"
+#include "logger.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace mdtools {
+
+    namespace {
+        size_t round_up(size_t bytes, size_t alignment) {
+            return (bytes + alignment - 1) / alignment * alignment;
+        }
+
+        /// Free pages of the explicit huge page pool of huge_page_size, 0 when there is none.
+        size_t free_huge_pages(size_t huge_page_size) {
+            std::ifstream meminfo("/proc/meminfo");
+            std::string key;
+            size_t value = 0, free_pages = 0, page_kb = 0;
+            while (meminfo >> key >> value) {
+                if (key == "HugePages_Free:") { free_pages = value; }
+                if (key == "Hugepagesize:") { page_kb = value; }
+                meminfo.ignore(256, '\n');
+            }
+            return page_kb * 1024 == huge_page_size ? free_pages : 0;
+        }
+
+        /// Map bytes of address space aligned to a huge page, halving them until the mapping succeeds.
+        char *map_region(size_t &bytes, size_t huge_page_size, int flags) {
+            while (bytes >= huge_page_size) {
+                void *address = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | flags,
+                                     -1, 0);
+                if (address != MAP_FAILED) {
+                    return static_cast<char *>(address);
+                }
+                bytes = round_up(bytes / 2, huge_page_size);
+            }
+            bytes = 0;
+            return nullptr;
+        }
+    }
+
+    void trajectoryArena::reserve() {
+        reserved = true;
+
+#ifdef MAP_HUGETLB
+        auto &explicit_pages = regions[0];
+        explicit_pages.capacity = free_huge_pages(huge_page_size) * huge_page_size;
+        if (explicit_pages.capacity > 0) {
+            // The huge pages are reserved by the mapping: if another process took them since the pool was read, the
+            // mapping fails (and shrinks) here instead of the first touch failing with SIGBUS.
+            explicit_pages.begin = map_region(explicit_pages.capacity, huge_page_size, MAP_HUGETLB);
+        }
+#endif
+
+        // Twice the physical memory: the address space is not committed, and a streamed trajectory is moved
+        // from its blocks into the final store.
+        auto &transparent_pages = regions[1];
+        auto physical = static_cast<size_t>(sysconf(_SC_PHYS_PAGES)) * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t bytes = round_up(2 * physical, huge_page_size) + huge_page_size;
+        auto begin = map_region(bytes, huge_page_size, MAP_NORESERVE);
+        if (begin != nullptr) {
+            // Start on a huge page boundary, the head is given back.
+            auto aligned = reinterpret_cast<char *>(round_up(reinterpret_cast<size_t>(begin), huge_page_size));
+            if (aligned != begin) {
+                munmap(begin, aligned - begin);
+            }
+            transparent_pages.begin = aligned;
+            transparent_pages.capacity = (bytes - (aligned - begin)) / huge_page_size * huge_page_size;
+#ifdef MADV_HUGEPAGE
+            madvise(transparent_pages.begin, transparent_pages.capacity, MADV_HUGEPAGE);
+#endif
+        }
+
+        LOGGER.info << "Trajectory arena: " << (regions[0].capacity >> 20) << " MB of explicit huge pages, "
+                    << (regions[1].capacity >> 20) << " MB of transparent huge pages reserved" << std::endl;
+    }
+
+    trajectoryArena::~trajectoryArena() {
+        for (auto &region: regions) {
+            if (region.begin != nullptr) {
+                munmap(region.begin, region.capacity);
+            }
+        }
+    }
+
+    void *trajectoryArena::allocate(size_t bytes, size_t alignment) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto requested = bytes;
+        bytes = round_up(bytes, alignment);
+        void *address = nullptr;
+        if (allocator == allocator_t::ARENA) {
+            if (!reserved) {
+                reserve();
+            }
+            // Every block starts on a huge page, so blocks never share one.
+            auto block = round_up(bytes, huge_page_size);
+            for (auto &region: regions) {
+                if (region.begin != nullptr && region.capacity - region.used >= block) {
+                    address = region.begin + region.used;
+                    region.used += block;
+                    break;
+                }
+            }
+        }
+        if (address == nullptr) {
+            address = std::aligned_alloc(alignment, bytes);
+        }
+        if (address != nullptr) {
+            allocated += requested;
+            peak = std::max(peak, allocated);
+        }
+        return address;
+    }
+
+    void trajectoryArena::release(void *address, size_t bytes) {
+        if (address == nullptr) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        allocated -= std::min(allocated, bytes);
+        for (auto &region: regions) {
+            if (!region.contains(address)) {
+                continue;
+            }
+            auto block = round_up(bytes, huge_page_size);
+            // The pages go back to the system, the address space is reused only when the block is the last one.
+            madvise(address, block, MADV_DONTNEED);
+            if (static_cast<char *>(address) + block == region.begin + region.used) {
+                region.used -= block;
+            }
+            return;
+        }
+        std::free(address);
+    }
+
+    void trajectoryArena::logSummary() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (peak == 0) {
+            return;
+        }
+        LOGGER.info << "Trajectory memory peak: " << (peak >> 20) << " MB ("
+                    << (allocator == allocator_t::ARENA ? "arena" : "malloc") << ")" << std::endl;
+    }
+
+} // mdtools
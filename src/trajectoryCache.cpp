@@ -0,0 +1,130 @@
+// MDTools
+//     Copyright (C)  2025  Pablo Galaviz
+//
+//     This program is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+//
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+//
+//     You should have received a copy of the GNU General Public License
+//     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//
+// Created by Pablo Galaviz on 16/10/2026.
+//
+
+#include "trajectoryCache.h"
+#include <cstring>
+
+namespace mdtools {
+
+    namespace {
+        constexpr char cache_magic[8] = {'M', 'D', 'T', 'C', 'A', 'C', 'H', 'E'};
+        constexpr uint32_t cache_version = 1;
+
+        template<class T>
+        void store_column(char *destination, const std::valarray<double> &position, double minimum, double length,
+                          bool scaled) {
+            auto values = reinterpret_cast<T *>(destination);
+            for (size_t i = 0; i < position.size(); i++) {
+                values[i] = static_cast<T>(scaled ? position[i] : (position[i] - minimum) / length);
+            }
+        }
+
+        // Whether count items of size bytes starting at offset end by end, divided so that it cannot overflow.
+        bool fits(uint64_t offset, uint64_t count, uint64_t size, uint64_t end) {
+            return offset <= end && offset % cache_alignment == 0 && (size == 0 || count <= (end - offset) / size);
+        }
+    }
+
+    const cache_header_t *read_cache_header(const mappedFile &file) {
+        if (file.length() < sizeof(cache_header_t)) {
+            return nullptr;
+        }
+        auto header = reinterpret_cast<const cache_header_t *>(file.begin());
+        if (memcmp(header->magic, cache_magic, sizeof(cache_magic)) != 0 || header->version != cache_version ||
+            (header->value_size != sizeof(float) && header->value_size != sizeof(double)) ||
+            header->number_of_atoms > file.length() / header->value_size) {
+            return nullptr;
+        }
+        // Header, atom types, frame blocks and box table follow each other, every region must lie inside the file.
+        if (header->atom_type_offset < sizeof(cache_header_t) ||
+            header->frame_stride != 3 * cache_padded(header->number_of_atoms * header->value_size) ||
+            !fits(header->atom_type_offset, header->number_of_atoms, sizeof(int32_t), header->frame_offset) ||
+            !fits(header->frame_offset, header->number_of_frames, header->frame_stride, header->box_offset) ||
+            !fits(header->box_offset, header->number_of_frames, sizeof(cache_box_t), file.length())) {
+            return nullptr;
+        }
+        return header;
+    }
+
+    trajectoryCacheWriter::trajectoryCacheWriter(const std::string &file_name, bool single_precision) {
+        output.open(file_name, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+        memcpy(header.magic, cache_magic, sizeof(cache_magic));
+        header.version = cache_version;
+        header.value_size = single_precision ? sizeof(float) : sizeof(double);
+    }
+
+    void trajectoryCacheWriter::write(const frame &current) {
+
+        if (header.number_of_frames == 0) {
+            // Atom types are written once, from the first frame.
+            header.number_of_atoms = current.number_of_atoms;
+            header.atom_type_offset = cache_alignment;
+            header.frame_offset = header.atom_type_offset + cache_padded(current.number_of_atoms * sizeof(int32_t));
+            header.frame_stride = 3 * cache_padded(current.number_of_atoms * header.value_size);
+            std::vector<char> atom_types(header.frame_offset, 0);
+            auto types = reinterpret_cast<int32_t *>(atom_types.data() + header.atom_type_offset);
+            for (size_t i = 0; i < current.number_of_atoms; i++) { types[i] = current.atom_type[i]; }
+            output.write(atom_types.data(), static_cast<std::streamsize>(atom_types.size()));
+            block.assign(header.frame_stride, 0);
+        }
+        if (current.number_of_atoms != header.number_of_atoms) {
+            LOGGER.error << "Inconsistent number of atoms at frame:" << current.time_step_id << std::endl;
+            exit(-1);
+        }
+
+        cache_box_t box{};
+        box.time_step_id = current.time_step_id;
+        for (int c = X; c <= Z; c++) {
+            box.minimum[c] = current.lattice[c].minimum;
+            box.maximum[c] = current.lattice[c].maximum;
+        }
+        boxes.push_back(box);
+
+        auto column_size = header.frame_stride / 3;
+        const std::valarray<double> *columns[3] = {&current.position_x, &current.position_y, &current.position_z};
+        for (int c = X; c <= Z; c++) {
+            double length = current.lattice[c].maximum - current.lattice[c].minimum;
+            if (header.value_size == sizeof(float)) {
+                store_column<float>(block.data() + c * column_size, *columns[c], current.lattice[c].minimum, length,
+                                    current.scaled);
+            } else {
+                store_column<double>(block.data() + c * column_size, *columns[c], current.lattice[c].minimum, length,
+                                     current.scaled);
+            }
+        }
+        output.write(block.data(), static_cast<std::streamsize>(block.size()));
+        header.number_of_frames++;
+    }
+
+    bool trajectoryCacheWriter::close() {
+        if (header.number_of_frames == 0) {
+            header.atom_type_offset = header.frame_offset = cache_alignment;
+            output.write(std::vector<char>(cache_alignment, 0).data(), cache_alignment);
+        }
+        header.box_offset = header.frame_offset + header.number_of_frames * header.frame_stride;
+        output.write(reinterpret_cast<const char *>(boxes.data()),
+                     static_cast<std::streamsize>(boxes.size() * sizeof(cache_box_t)));
+        output.seekp(0);
+        output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        output.close();
+        return !output.fail();
+    }
+
+}
@@ -19,42 +19,126 @@
 //
 
 #include "trajectoryReader.h"
+#include "bgzf.h"
+#include "lammpsParser.h"
+#include "trajectoryCache.h"
+#include "xdatcarParser.h"
 #include "xdrfile/xdrfile.h"
 #include "xdrfile/xdrfile_trr.h"
+#include "xdrfile/xdrfile_xtc.h"
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <exception>
+#include <omp.h>
 #include <iostream>
+#include <limits>
+#include <stdexcept>
 
 namespace mdtools {
-        trajectoryReader::trajectoryReader(const std::string& fn,const std::string& coordinates_file_name) {
+        trajectoryReader::trajectoryReader(const io_options_t &io_options) {
 
-        file_name=fn;
+        file_name=io_options.trajectory_input_file;
+        segments = list_input_files(file_name);
+        if (segments.size() > 1) {
+            format = static_cast<format_t>(file_format(segments[0]) & format_t::FILE_TYPE);
+            for (auto &segment: segments) {
+                if ((file_format(segment) & format_t::FILE_TYPE) != format) {
+                    LOGGER.error << "All trajectory segments should have the same format: " << segment << std::endl;
+                    exit(EINVAL);
+                }
+            }
+            LOGGER.info << "Reading " << segments.size() << " trajectory segments, from " << segments.front()
+                        << " to " << segments.back() << std::endl;
+            segment_options = io_options;
+            readTrajectory = &trajectoryReader::readSegmentTrajectory;
+            readFrame = &trajectoryReader::readSegmentFrame;
+            return;
+        }
+        if (segments.size() == 1) {
+            file_name = segments[0];
+        }
+        selection = atomSelection(io_options);
+        const auto &coordinates_file_name = io_options.coordinates_input_file;
         auto format_flag = file_format(file_name);
-        auto format = static_cast<format_t>(format_flag & format_t::FILE_TYPE);
+        format = static_cast<format_t>(format_flag & format_t::FILE_TYPE);
 
         switch (format) {
 
             case format_t::LAMMPS:
             {
-                file.open(file_name, std::ios_base::in | std::ios_base::binary);
-                if (format_flag & GZIP) { input_buffer.push(boost::iostreams::gzip_decompressor()); }
+                lammps_columns = std::make_unique<lammps_columns_t>();
+                lammps_columns->velocity_scale = lammps_velocity_scale(io_options.lammps_units);
+                lammps_frame_index = io_options.frame_index;
+                if (!(format_flag & GZIP) && io_options.lammps_parser == "mmap") {
+                    mapLammpsTrajectory(std::make_unique<mappedFile>(file_name));
+                    break;
+                }
+                // Blocked gzip is streamed a batch of blocks at a time, which are inflated in parallel. get() inflates
+                // the whole file in memory instead, to parse its frames concurrently. Plain gzip goes through zlib.
+                if ((format_flag & GZIP) && is_bgzf(file_name) && io_options.lammps_parser == "mmap") {
+                    blocked_gzip = std::make_unique<bgzfStreambuf>(file_name);
+                    input_stream = new std::istream(blocked_gzip.get());
+                    // A corrupted block is thrown to the caller of next() instead of ending the stream.
+                    input_stream->exceptions(std::ios_base::badbit);
+                } else {
+                    file.open(file_name, std::ios_base::in | std::ios_base::binary);
+                    if (format_flag & GZIP) { input_buffer.push(boost::iostreams::gzip_decompressor()); }
+                    input_buffer.push(file);
+                    //Convert stream buffer to istream
+                    input_stream = new std::istream(&input_buffer);
+                    input_buffer.set_auto_close(false);
+                }
+                readFrame = &trajectoryReader::readLammpsFrame;
+            }
+                break;
+            case format_t::GRO:
+            {
+                file.open(file_name, std::ios_base::in);
                 input_buffer.push(file);
                 //Convert stream buffer to istream
                 input_stream = new std::istream(&input_buffer);
                 input_buffer.set_auto_close(false);
-                getTrajectory = &trajectoryReader::getLammpsTrajectory;
+                readTrajectory = &trajectoryReader::readGroTrajectory;
+                readFrame = &trajectoryReader::readGroFrame;
             }
                 break;
             case format_t::XDATCAR:
-            {getTrajectory = &trajectoryReader::getXDATCARTrajectory;}
+            {
+                mapped_file = std::make_unique<mappedFile>(file_name);
+                cursor = mapped_file->begin();
+                xdatcar_header = std::make_unique<xdatcar_header_t>();
+                readTrajectory = &trajectoryReader::readMappedXDATCARTrajectory;
+                readFrame = &trajectoryReader::readXDATCARFrame;
+            }
                 break;
-            case format_t::XTC:
+            case format_t::CACHE:
             {
-                getTrajectory = &trajectoryReader::getXTCTrajectory;}
+                mapped_file = std::make_unique<mappedFile>(file_name);
+                cache = read_cache_header(*mapped_file);
+                if (cache == nullptr) {
+                    LOGGER.error << "Invalid trajectory cache " << file_name << std::endl;
+                    exit(EINVAL);
+                }
+                number_of_atoms = static_cast<int>(cache->number_of_atoms);
+                auto types = reinterpret_cast<const int32_t *>(mapped_file->begin() + cache->atom_type_offset);
+                resolveSelection(std::vector<int>(types, types + number_of_atoms));
+                // Frame blocks have a fixed size, selected frames are reached with a seek.
+                frame_index = std::make_unique<frameIndex>(file_name);
+                frame_index->frames.resize(cache->number_of_frames);
+                for (size_t i = 0; i < cache->number_of_frames; i++) {
+                    frame_index->frames[i].offset = cache->frame_offset + i * cache->frame_stride;
+                    frame_index->frames[i].number_of_atoms = number_of_atoms;
+                }
+                cursor = mapped_file->begin() + cache->frame_offset;
+                readFrame = &trajectoryReader::readCacheFrame;
+            }
                 break;
+            case format_t::XTC:
             case format_t::TRR:
             {
-                auto format_flag = file_format(coordinates_file_name);
-                auto format = static_cast<format_t>(format_flag & format_t::FILE_TYPE);
-                if(format != format_t::GRO){
+                auto coordinates_flag = file_format(coordinates_file_name);
+                auto coordinates_format = static_cast<format_t>(coordinates_flag & format_t::FILE_TYPE);
+                if(coordinates_format != format_t::GRO){
                     LOGGER.error << "Required gro coordinates file" << std::endl;
                     exit(EINVAL);
                 }
@@ -69,7 +153,14 @@ namespace mdtools {
                 //Convert stream buffer to istream
                 input_stream = new std::istream(&input_buffer);
                 input_buffer.set_auto_close(false);
-                getTrajectory = &trajectoryReader::getTRRTrajectory;}
+                if (format == format_t::XTC) {
+                    xdrfile_set_fast_decompression(io_options.xtc_decoder == "fast");
+                    readTrajectory = &trajectoryReader::readXTCTrajectory;
+                    readFrame = &trajectoryReader::readXTCFrame;
+                } else {
+                    readFrame = &trajectoryReader::readTRRFrame;
+                }
+            }
                 break;
 
             case format_t::UNKNOWN:
@@ -80,153 +171,807 @@ namespace mdtools {
 
     }
 
-    std::vector<atom_t> trajectoryReader::getLammpsTrajectory(double time_step, int start_iteration,int delta_iteration ,int end_iteration) {
+    void trajectoryReader::begin(int start, int delta, int end) {
+        start_iteration = start;
+        delta_iteration = std::max(delta, 1);
+        end_iteration = end;
+        frame_id = 0;
+        read_start = std::chrono::steady_clock::now();
+    }
+
+    size_t trajectoryReader::bytesRead() {
+        if (segments.size() > 1) {
+            size_t total = 0;
+            for (auto &segment: segments) { total += boost::filesystem::file_size(segment); }
+            return total;
+        }
+        if (mapped_file) {
+            return cursor - mapped_file->begin();
+        }
+        if (xdr) {
+            return xdr_tell(xdr);
+        }
+        if (format == format_t::LAMMPS || format == format_t::GRO) {
+            auto position = file.tellg();
+            if (position >= 0) {
+                return static_cast<size_t>(position);
+            }
+        }
+        return boost::filesystem::file_size(file_name);
+    }
+
+    void trajectoryReader::logReadingRate() {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - read_start).count();
+        double megabytes = static_cast<double>(bytesRead()) / (1024 * 1024);
+        LOGGER.info << "Read " << megabytes << " MB in " << seconds << " s (" << megabytes / seconds << " MB/s)"
+                    << std::endl;
+    }
+
+    void trajectoryReader::resolveSelection(const std::vector<int> &types) {
+        if (selection.all() || selection.active()) {
+            return;
+        }
+        selection.resolve(types);
+        LOGGER.info << "Selected " << selection.size(types.size()) << " of " << types.size() << " atoms" << std::endl;
+        if (selection.size(types.size()) == 0) {
+            LOGGER.error << "No atom matches io.atom_types, io.atom_indices and io.index_group" << std::endl;
+            exit(EINVAL);
+        }
+    }
+
+    void trajectoryReader::selectAtoms(frame &current) {
+        // The first frame read in full fixes the selection, later frames are read selected.
+        if (selection.all()) {
+            return;
+        }
+        if (!selection.active()) {
+            resolveSelection(std::vector<int>(std::begin(current.atom_type), std::end(current.atom_type)));
+        }
+        if (current.number_of_atoms == number_of_atoms && selection.size(number_of_atoms) < static_cast<size_t>(number_of_atoms)) {
+            selection.compact(current);
+        }
+    }
+
+    bool trajectoryReader::readNext(frame &current) {
+        if (readFrame == nullptr) {
+            LOGGER.error << "Frame by frame reading is not supported for " << file_name << std::endl;
+            return false;
+        }
+        if (frame_index) {
+            seekSelectedFrame();
+        }
+        while (end_iteration <= 0 || frame_id < end_iteration) {
+            bool selected = is_selected_frame(frame_id, start_iteration, delta_iteration, end_iteration);
+            if (!(this->*readFrame)(current, !selected)) {
+                break;
+            }
+            frame_id++;
+            if (selected) {
+                return true;
+            }
+        }
+        logReadingRate();
+        return false;
+    }
+
+    bool trajectoryReader::next(frame &current) {
+        if (!readNext(current)) {
+            return false;
+        }
+        if (current.scaled) {
+            unscale(current);
+        }
+        return true;
+    }
+
+    void trajectoryReader::unscale(frame &current) {
+        if (reference_x.size() != current.number_of_atoms) {
+            reference_x = current.position_x;
+            reference_y = current.position_y;
+            reference_z = current.position_z;
+        }
+
+        auto unwrap = [](double position, double reference) {
+            if (std::abs(position - reference) > 0.5) {
+                return position > reference ? position - 1 : position + 1;
+            }
+            return position;
+        };
+
+        double ax = current.lattice[X].maximum - current.lattice[X].minimum;
+        double ay = current.lattice[Y].maximum - current.lattice[Y].minimum;
+        double az = current.lattice[Z].maximum - current.lattice[Z].minimum;
+        for (size_t i = 0; i < current.number_of_atoms; i++) {
+            current.position_x[i] = current.lattice[X].minimum + ax * unwrap(current.position_x[i], reference_x[i]);
+            current.position_y[i] = current.lattice[Y].minimum + ay * unwrap(current.position_y[i], reference_y[i]);
+            current.position_z[i] = current.lattice[Z].minimum + az * unwrap(current.position_z[i], reference_z[i]);
+        }
+        current.scaled = false;
+    }
+
+    bool trajectoryReader::readLammpsFrame(frame &current, bool skip) {
 
         std::string line;
 
-        int number_of_atoms = 0;
-        int frame_count = 0;
-        size_t box_coordinate = 0;
-        state_t current_state = READING_NONE;
-        std::vector<frame> trajectory;
-        frame new_frame;
+        // Find the beginning of the next frame
+        bool found = false;
         while (std::getline(*input_stream, line)) {
+            if (line.find("ITEM: TIMESTEP") != std::string::npos) {
+                found = true;
+                break;
+            }
+        }
+        if (!found || !std::getline(*input_stream, line)) {
+            return false;
+        }
+        current.time_step_id = stoi(line);
 
-            std::size_t item_found = line.find("ITEM");
-            if (item_found != std::string::npos) {
-                std::vector<std::string> fields;
-                boost::algorithm::split(fields, line, boost::is_any_of(":"));
-                if (fields[1].find("TIMESTEP") != std::string::npos) {
-                    frame_count++;
-                    if(frame_count <= start_iteration || frame_count%delta_iteration !=0 ){
-                        current_state = SKIP_FRAME;
-                    }
-                    else
-                    {
-                        if(end_iteration > 0 && frame_count > end_iteration ){
-                            break;
-                        }
-                        current_state = READING_STEP;
-                        if (new_frame.time_step_id >= 0) {
-                            trajectory.push_back(new_frame);
-                            new_frame.reset();
-                        }
+        size_t box_coordinate = 0;
+        while (std::getline(*input_stream, line)) {
+            if (line.find("ITEM:") == std::string::npos) {
+                LOGGER.debug << line << std::endl;
+                continue;
+            }
+            if (line.find("NUMBER OF ATOMS") != std::string::npos) {
+                std::getline(*input_stream, line);
+                int noa = stoi(line);
+                if (number_of_atoms == 0) {
+                    number_of_atoms = noa;
+                } else {
+                    if (number_of_atoms != noa) {
+                        LOGGER.warning << "Inconsistent number of atoms at frame:" << current.time_step_id
+                                       << std::endl;
+                        LOGGER.warning << "Found:" << noa << " expecting:" << number_of_atoms << std::endl;
+                        throw std::runtime_error("Inconsistent number of atoms at frame " +
+                                                 std::to_string(current.time_step_id));
                     }
-                    continue;
-                }
-                if (current_state == SKIP_FRAME){
-                    continue;
-                }
-                if (fields[1].find("NUMBER OF ATOMS") != std::string::npos) {
-                    current_state = READING_N_ATOMS;
-                    continue;
                 }
-                if (fields[1].find("BOX BOUNDS") != std::string::npos) {
-                    current_state = READING_BOX;
-                    continue;
-                }
-                if (fields[1].find("ATOMS") != std::string::npos) {
-                    current_state = READING_POSITION;
-                    continue;
+                current.resize(selection.size(number_of_atoms));
+                continue;
+            }
+            if (line.find("BOX BOUNDS") != std::string::npos) {
+                for (box_coordinate = 0; box_coordinate < 3 && std::getline(*input_stream, line); box_coordinate++) {
+                    char *pEnd;
+                    current.lattice[box_coordinate].minimum = strtod(line.c_str(), &pEnd) / 10;
+                    current.lattice[box_coordinate].maximum = strtod(pEnd, nullptr) / 10;
                 }
-                LOGGER.info << fields[1] << std::endl;
-            } else {
-                if (current_state == SKIP_FRAME){
-                    continue;
+                continue;
+            }
+            if (line.find("ATOMS") != std::string::npos) {
+                // The column layout is taken from the first frame.
+                if (!lammps_columns->resolved) {
+                    auto velocity_scale = lammps_columns->velocity_scale;
+                    if (!parse_lammps_columns(line, *lammps_columns)) {
+                        LOGGER.warning << "Unknown lammps columns, reading id type xs ys zs: " << line << std::endl;
+                        *lammps_columns = lammps_columns_t();
+                        lammps_columns->resolved = true;
+                    }
+                    lammps_columns->velocity_scale = velocity_scale;
+                    logLammpsColumns();
                 }
-                if (current_state == READING_STEP) {
-                    new_frame.time_step_id = stoi(line);
-                    current_state = READING_NONE;
-                    continue;
+                current.scaled = !lammps_columns->unwrapped;
+                current.unwrapped = lammps_columns->unwrapped;
+                if (!skip) {
+                    current.resize_velocities(lammps_columns->velocities);
                 }
-                if (current_state == READING_N_ATOMS) {
-                    size_t noa = stoi(line);
-                    if (number_of_atoms == 0) {
-                        number_of_atoms = noa;
-                    } else {
-                        if (number_of_atoms != noa) {
-                            LOGGER.warning << "Inconsistent number of atoms at frame:" << new_frame.time_step_id
-                                           << std::endl;
-                            LOGGER.warning << "Found:" << noa << " expecting:" << number_of_atoms << std::endl;
-                            exit(-1);
-                        }
+                int i = 0;
+                for (; i < number_of_atoms && std::getline(*input_stream, line); i++) {
+                    if (skip) {
+                        continue;
+                    }
+                    if (!parse_lammps_atom(line.data(), line.data() + line.size(), *lammps_columns, current,
+                                           number_of_atoms, activeSelection())) {
+                        LOGGER.warning << line << std::endl;
                     }
-                    new_frame.number_of_atoms = number_of_atoms;
-                    new_frame.position_x.resize(number_of_atoms);
-                    new_frame.position_y.resize(number_of_atoms);
-                    new_frame.position_z.resize(number_of_atoms);
-                    new_frame.atom_type.resize(number_of_atoms);
-                    current_state = READING_NONE;
-                    continue;
                 }
-                if (current_state == READING_BOX) {
-                    char *pEnd;
-                    new_frame.lattice[box_coordinate].minimum = strtod(line.c_str(), &pEnd)/10;
-                    new_frame.lattice[box_coordinate].maximum = strtod(pEnd, NULL)/10;
-                    box_coordinate = (box_coordinate + 1) % 3;
-                    continue;
+                // The stream ends inside the atom section (e.g. a dump still being written).
+                if (i < number_of_atoms) {
+                    return false;
+                }
+                if (!skip) {
+                    selectAtoms(current);
                 }
+                return true;
+            }
+            LOGGER.info << line << std::endl;
+        }
 
-                if (current_state == READING_POSITION) {
-                    char *pEnd;
-                    auto id = strtol(line.c_str(), &pEnd, 10) - 1;
-                    if (id < 0 || id >= new_frame.number_of_atoms) {
-                        LOGGER.warning << line << std::endl;
-                        continue;
-                    }
-                    new_frame.atom_type[id] = static_cast<int>(strtol(pEnd, &pEnd, 10));
-                    new_frame.position_x[id] = strtod(pEnd, &pEnd);
-                    new_frame.position_y[id] = strtod(pEnd, &pEnd);
-                    new_frame.position_z[id] = strtod(pEnd, &pEnd);
-                    continue;
+        return false;
+    }
+
+    bool trajectoryReader::readMappedLammpsFrame(frame &current, bool skip) {
+        frame_status_t status;
+        auto position = parse_lammps_frame(cursor, mapped_file->end(), current, number_of_atoms, skip,
+                                           *lammps_columns, status, activeSelection());
+        if (!report_frame_status(status, current.time_step_id, number_of_atoms)) {
+            throw std::runtime_error("Inconsistent number of atoms at frame " + std::to_string(current.time_step_id));
+        }
+        if (position == nullptr) {
+            cursor = mapped_file->end();
+            return false;
+        }
+        cursor = position;
+        if (!skip) {
+            selectAtoms(current);
+        }
+        return true;
+    }
+
+    void trajectoryReader::mapLammpsTrajectory(std::unique_ptr<mappedFile> memory) {
+        mapped_file = std::move(memory);
+        cursor = mapped_file->begin();
+        auto velocity_scale = lammps_columns->velocity_scale;
+        *lammps_columns = find_lammps_columns(mapped_file->begin(), mapped_file->end());
+        lammps_columns->velocity_scale = velocity_scale;
+        logLammpsColumns();
+        readFrame = &trajectoryReader::readMappedLammpsFrame;
+        if (lammps_frame_index) {
+            loadLammpsFrameIndex();
+        }
+    }
+
+    void trajectoryReader::loadLammpsFrameIndex() {
+        frame_index = std::make_unique<frameIndex>(file_name);
+        if (frame_index->load(mapped_file->length())) {
+            return;
+        }
+        frame_index->frames = index_lammps_frames(mapped_file->begin(), mapped_file->end());
+        frame_index->save();
+        LOGGER.info << "Frame index " << frame_index->sidecar() << " created, number of frames: "
+                    << frame_index->size() << std::endl;
+    }
+
+    void trajectoryReader::logLammpsColumns() const {
+        if (lammps_columns->unwrapped) {
+            LOGGER.info << "Using the unwrapped positions of the lammps dump" << std::endl;
+        }
+        if (lammps_columns->velocities) {
+            LOGGER.info << "Using the velocities of the lammps dump (scaled by " << lammps_columns->velocity_scale
+                        << " to nm/fs)" << std::endl;
+        }
+    }
+
+    void trajectoryReader::seekSelectedFrame() {
+        long next_id = start_iteration;
+        if (frame_id > start_iteration) {
+            next_id += (frame_id - start_iteration + delta_iteration - 1) / delta_iteration * delta_iteration;
+        }
+        if (next_id >= static_cast<long>(frame_index->size())) {
+            frame_id = static_cast<long>(frame_index->size());
+            if (xdr) {
+                xdr_seek(xdr, 0, SEEK_END);
+            } else {
+                cursor = mapped_file->end();
+            }
+            return;
+        }
+        frame_id = next_id;
+        if (xdr) {
+            xdr_seek(xdr, static_cast<int64_t>((*frame_index)[next_id].offset), SEEK_SET);
+        } else {
+            cursor = mapped_file->begin() + (*frame_index)[next_id].offset;
+        }
+    }
+
+    void trajectoryReader::setXDRFrameIndex(int64_t *offsets, unsigned long number_of_frames) {
+        // Kept in memory only, the offsets come from a scan of the frame headers which is cheap.
+        frame_index = std::make_unique<frameIndex>(file_name);
+        frame_index->frames.resize(number_of_frames);
+        for (unsigned long i = 0; i < number_of_frames; i++) {
+            frame_index->frames[i].offset = static_cast<uint64_t>(offsets[i]);
+            frame_index->frames[i].number_of_atoms = number_of_atoms;
+        }
+        free(offsets);
+    }
+
+    bool trajectoryReader::skipXTCFrame(frame &current) {
+        auto position = static_cast<uint64_t>(xdr_tell(xdr));
+        // The frame starts with the magic number, the number of atoms and the step.
+        int header[3];
+        if (xdrfile_read_int(header, 3, xdr) != 3) {
+            return false;
+        }
+        current.time_step_id = header[2];
+        auto next = std::upper_bound(frame_index->frames.begin(), frame_index->frames.end(), position,
+                                     [](uint64_t offset, const frame_index_entry_t &entry) {
+                                         return offset < entry.offset;
+                                     });
+        if (next == frame_index->frames.end()) {
+            return xdr_seek(xdr, 0, SEEK_END) == exdrOK;
+        }
+        return xdr_seek(xdr, static_cast<int64_t>(next->offset), SEEK_SET) == exdrOK;
+    }
+
+    namespace {
+        // Frames transposed together into the atom series: at least one per thread, about 64 MB of positions.
+        size_t frames_per_chunk(size_t number_of_atoms) {
+            constexpr size_t chunk_bytes = size_t(64) << 20;
+            auto frame_bytes = std::max<size_t>(1, 3 * sizeof(double) * number_of_atoms);
+            return std::max(static_cast<size_t>(omp_get_max_threads()), chunk_bytes / frame_bytes);
+        }
+    }
+
+    template<class T>
+    basic_trajectory_t<T> trajectoryReader::getMappedLammpsTrajectory(double time_step) {
+
+        std::vector<const char *> frames;
+        if (frame_index) {
+            frames.reserve(frame_index->size());
+            for (auto &entry: frame_index->frames) { frames.push_back(mapped_file->begin() + entry.offset); }
+        } else {
+            frames = find_lammps_frames(cursor, mapped_file->end());
+        }
+        auto n = selected_frames(frames.size(), start_iteration, delta_iteration, end_iteration);
+        frame_id = static_cast<long>(frames.size());
+        cursor = mapped_file->end();
+
+        // The first selected frame fixes the number of atoms and the atom selection.
+        std::vector<frame> chunk(1);
+        std::vector<frame_status_t> status(1);
+        auto parsed_first = n > 0 && parse_lammps_frame(frames[start_iteration], mapped_file->end(), chunk[0],
+                                                        number_of_atoms, false, *lammps_columns, status[0],
+                                                        activeSelection()) != nullptr;
+        if (!report_frame_status(status[0], chunk[0].time_step_id, number_of_atoms)) {
+            throw std::runtime_error("Inconsistent number of atoms at frame " + std::to_string(chunk[0].time_step_id));
+        }
+        if (!parsed_first) {
+            logReadingRate();
+            return {};
+        }
+        selectAtoms(chunk[0]);
+        auto frame_selection = activeSelection();
+
+        // Chunks of frames are parsed concurrently, each frame in its own buffer, and then stored in their
+        // columns of the trajectory, so only one chunk is held besides the trajectory.
+        basic_trajectory_t<T> trajectory(chunk[0].number_of_atoms, n, time_step);
+        chunk.resize(std::min(frames_per_chunk(chunk[0].number_of_atoms), n));
+        status.resize(chunk.size());
+        size_t kept = n;
+        for (size_t first = 0; first < n; first += chunk.size()) {
+            auto count = std::min(chunk.size(), n - first);
+            std::vector<char> complete(count, true);
+#pragma omp parallel for schedule(dynamic)
+            for (size_t i = first == 0 ? 1 : 0; i < count; i++) {
+                int expected_atoms = number_of_atoms;
+                complete[i] = parse_lammps_frame(frames[start_iteration + (first + i) * delta_iteration],
+                                                 mapped_file->end(), chunk[i], expected_atoms, false,
+                                                 *lammps_columns, status[i], frame_selection) != nullptr;
+            }
+            // Drop a truncated frame (e.g. a dump still being written) and everything after it.
+            auto parsed = static_cast<size_t>(std::find(complete.begin(), complete.end(), false) - complete.begin());
+            // What the workers found is reported here, up to the first frame that is not complete.
+            for (size_t i = first == 0 ? 1 : 0; i < std::min(parsed + 1, count); i++) {
+                if (!report_frame_status(status[i], chunk[i].time_step_id, number_of_atoms)) {
+                    throw std::runtime_error("Inconsistent number of atoms at frame " +
+                                             std::to_string(chunk[i].time_step_id));
                 }
+            }
+            storeFrames(chunk, parsed, trajectory, first);
+            if (parsed < count) {
+                kept = first + parsed;
+                break;
+            }
+        }
+        trajectory.truncate(kept);
+        trajectory.scaled = !chunk[0].unwrapped;
+        logReadingRate();
 
-                LOGGER.debug << line << std::endl;
+        return trajectory;
+    }
+
+    template<class T>
+    basic_trajectory_t<T> trajectoryReader::getLammpsTrajectory(double time_step) {
+
+        if (blocked_gzip && !mapped_file) {
+            mapLammpsTrajectory(std::make_unique<bgzfFile>(file_name));
+        }
+        if (mapped_file) {
+            return getMappedLammpsTrajectory<T>(time_step);
+        }
+
+        // The number of frames of a stream is only known at its end. Chunks of frames are stored in blocks of
+        // atom series, which are moved into the trajectory one at a time and released: its pages are only
+        // touched while the blocks are freed, so the resident memory stays close to one copy of the data.
+        std::vector<frame> chunk(1);
+        if (!readNext(chunk[0])) {
+            return {};
+        }
+        chunk.resize(frames_per_chunk(chunk[0].number_of_atoms));
+        std::vector<basic_trajectory_t<T>> blocks;
+        size_t number_of_frames = 0;
+        size_t count = 1;
+        while (true) {
+            while (count < chunk.size() && readNext(chunk[count])) {
+                count++;
+            }
+            if (count == 0) {
+                break;
+            }
+            blocks.emplace_back(chunk[0].number_of_atoms, count, time_step);
+            storeFrames(chunk, count, blocks.back(), 0);
+            number_of_frames += count;
+            if (count < chunk.size()) {
+                break;
             }
+            count = 0;
+        }
 
+        basic_trajectory_t<T> trajectory;
+        if (blocks.size() == 1) {
+            trajectory = std::move(blocks[0]);
+        } else {
+            trajectory = basic_trajectory_t<T>(chunk[0].number_of_atoms, number_of_frames, time_step, false);
+            size_t first = 0;
+            for (auto &block: blocks) {
+                trajectory.copy_frames(block, first);
+                first += block.number_of_frames();
+                block = {};
+            }
         }
 
-        std::vector<atom_t> atom_trajectory = std::vector<atom_t>(trajectory[0].number_of_atoms);
-        for (int atom_id = 0; atom_id < atom_trajectory.size(); atom_id++) {
-            atom_trajectory[atom_id].time_step = time_step;
-            atom_trajectory[atom_id].atom_type = trajectory[0].atom_type[atom_id];
-            atom_trajectory[atom_id].position_x.resize(trajectory.size());
-            atom_trajectory[atom_id].position_y.resize(trajectory.size());
-            atom_trajectory[atom_id].position_z.resize(trajectory.size());
-            atom_trajectory[atom_id].lattice_a.resize(trajectory.size());
-            atom_trajectory[atom_id].lattice_b.resize(trajectory.size());
-            atom_trajectory[atom_id].lattice_c.resize(trajectory.size());
-            atom_trajectory[atom_id].lattice_origin_x.resize(trajectory.size());
-            atom_trajectory[atom_id].lattice_origin_y.resize(trajectory.size());
-            atom_trajectory[atom_id].lattice_origin_z.resize(trajectory.size());
-            atom_trajectory[atom_id].time.resize(trajectory.size());
-            for (int trajectory_id = 0; trajectory_id < trajectory.size(); trajectory_id++) {
-                atom_trajectory[atom_id].position_x[trajectory_id] = trajectory[trajectory_id].position_x[atom_id];
-                atom_trajectory[atom_id].position_y[trajectory_id] = trajectory[trajectory_id].position_y[atom_id];
-                atom_trajectory[atom_id].position_z[trajectory_id] = trajectory[trajectory_id].position_z[atom_id];
-                atom_trajectory[atom_id].time[trajectory_id] = trajectory[trajectory_id].time_step_id * time_step;
-                atom_trajectory[atom_id].lattice_origin_x[trajectory_id] = trajectory[trajectory_id].lattice[X].minimum;
-                atom_trajectory[atom_id].lattice_origin_y[trajectory_id] = trajectory[trajectory_id].lattice[Y].minimum;
-                atom_trajectory[atom_id].lattice_origin_z[trajectory_id] = trajectory[trajectory_id].lattice[Z].minimum;
-                atom_trajectory[atom_id].lattice_a[trajectory_id] = trajectory[trajectory_id].lattice[X].maximum-trajectory[trajectory_id].lattice[X].minimum;
-                atom_trajectory[atom_id].lattice_b[trajectory_id] = trajectory[trajectory_id].lattice[Y].maximum-trajectory[trajectory_id].lattice[Y].minimum;
-                atom_trajectory[atom_id].lattice_c[trajectory_id] = trajectory[trajectory_id].lattice[Z].maximum-trajectory[trajectory_id].lattice[Z].minimum;
+        trajectory.scaled = !chunk[0].unwrapped;
+        return trajectory;
+    }
+
+    template<class T>
+    void trajectoryReader::storeFrames(const std::vector<frame> &frames, size_t count, basic_trajectory_t<T> &trajectory,
+                                       size_t first_frame) {
+
+        if (count == 0) {
+            return;
+        }
+        bool velocities = frames[0].has_velocities();
+        if (velocities) {
+            trajectory.allocate_velocities();
+        }
+        for (size_t i = 0; i < count; i++) {
+            auto &current = frames[i];
+            trajectory.box(first_frame + i).set(current.time_step_id * trajectory.time_step,
+                                                {current.lattice[X].minimum, current.lattice[Y].minimum,
+                                                 current.lattice[Z].minimum},
+                                                {current.lattice[X].maximum, current.lattice[Y].maximum,
+                                                 current.lattice[Z].maximum});
+        }
 
+        // Every thread fills the rows of a contiguous range of atoms, so the reads of the frames it gathers
+        // from are shared by neighbouring atoms in cache.
+#pragma omp parallel for schedule(static)
+        for (int atom_id = 0; atom_id < trajectory.number_of_atoms(); atom_id++) {
+            trajectory.atom_type(atom_id) = frames[0].atom_type[atom_id];
+            auto position_x = trajectory.data(field_t::POSITION_X, atom_id) + first_frame;
+            auto position_y = trajectory.data(field_t::POSITION_Y, atom_id) + first_frame;
+            auto position_z = trajectory.data(field_t::POSITION_Z, atom_id) + first_frame;
+            for (size_t i = 0; i < count; i++) {
+                position_x[i] = frames[i].position_x[atom_id];
+                position_y[i] = frames[i].position_y[atom_id];
+                position_z[i] = frames[i].position_z[atom_id];
+            }
+            if (velocities) {
+                auto velocity_x = trajectory.data(field_t::VELOCITY_X, atom_id) + first_frame;
+                auto velocity_y = trajectory.data(field_t::VELOCITY_Y, atom_id) + first_frame;
+                auto velocity_z = trajectory.data(field_t::VELOCITY_Z, atom_id) + first_frame;
+                for (size_t i = 0; i < count; i++) {
+                    velocity_x[i] = frames[i].velocity_x[atom_id];
+                    velocity_y[i] = frames[i].velocity_y[atom_id];
+                    velocity_z[i] = frames[i].velocity_z[atom_id];
+                }
             }
-            atom_trajectory[atom_id].calculate_velocity();
-            atom_trajectory[atom_id].calculate_means();
+        }
+    }
+
+    template<class T>
+    basic_trajectory_t<T> trajectoryReader::getAtomTrajectory(const std::vector<frame> &trajectory, double time_step) {
+
+        if (trajectory.empty()) {
+            return {};
         }
 
+        basic_trajectory_t<T> atom_trajectory(trajectory[0].number_of_atoms, trajectory.size(), time_step);
+        storeFrames(trajectory, trajectory.size(), atom_trajectory, 0);
+        atom_trajectory.scaled = !trajectory[0].unwrapped;
         return atom_trajectory;
 
     }
 
-    std::vector<atom_t> trajectoryReader::getXDATCARTrajectory(double time_step, int start_iteration, int delta_iteration, int end_iteration) {
-        return std::vector<atom_t>();
+    bool trajectoryReader::readGroFrame(frame &current, bool skip) {
+
+        std::string line;
+
+        // Title line, gromacs writes "t= <time> step= <step>" when available
+        if (!std::getline(*input_stream, line)) {
+            return false;
+        }
+        auto step_found = line.find("step=");
+        current.time_step_id = step_found != std::string::npos ? stoi(line.substr(step_found + 5)) : static_cast<int>(frame_id);
+        current.scaled = true;
+
+        if (!std::getline(*input_stream, line)) {
+            return false;
+        }
+        int noa = stoi(line);
+        if (number_of_atoms == 0) {
+            number_of_atoms = noa;
+        } else {
+            if (number_of_atoms != noa) {
+                LOGGER.warning << "Inconsistent number of atoms at frame:" << current.time_step_id << std::endl;
+                LOGGER.warning << "Found:" << noa << " expecting:" << number_of_atoms << std::endl;
+                throw std::runtime_error("Inconsistent number of atoms at frame " +
+                                         std::to_string(current.time_step_id));
+            }
+        }
+        current.resize(selection.size(number_of_atoms));
+
+        for (int i = 0; i < number_of_atoms; i++) {
+            if (!std::getline(*input_stream, line)) {
+                return false;
+            }
+            auto slot = selection.slot(i);
+            if (skip || slot < 0) {
+                continue;
+            }
+            // Fixed format: residue number, residue name, atom name, atom number (5 chars each), x y z (8.3f)
+            current.atom_type[slot] = getAtomTypeFromGroLine(line);
+            current.position_x[slot] = strtod(line.substr(20, 8).c_str(), nullptr);
+            current.position_y[slot] = strtod(line.substr(28, 8).c_str(), nullptr);
+            current.position_z[slot] = strtod(line.substr(36, 8).c_str(), nullptr);
+        }
+
+        // Box line, only the diagonal of triclinic boxes is used
+        if (!std::getline(*input_stream, line)) {
+            return false;
+        }
+        char *pEnd;
+        current.lattice[X] = {0, strtod(line.c_str(), &pEnd)};
+        current.lattice[Y] = {0, strtod(pEnd, &pEnd)};
+        current.lattice[Z] = {0, strtod(pEnd, &pEnd)};
+
+        if (!skip) {
+            current.position_x /= current.lattice[X].maximum;
+            current.position_y /= current.lattice[Y].maximum;
+            current.position_z /= current.lattice[Z].maximum;
+            selectAtoms(current);
+        }
+
+        return true;
+    }
+
+    std::vector<frame> trajectoryReader::readGroTrajectory() {
+
+        std::vector<frame> trajectory;
+        frame new_frame;
+        while (readNext(new_frame)) {
+            trajectory.push_back(new_frame);
+        }
+
+        return trajectory;
+    }
+
+    bool trajectoryReader::readXDATCARFrame(frame &current, bool skip) {
+        auto end = mapped_file->end();
+        auto position = cursor;
+        // The header comes first, and again before every configuration of a variable cell run.
+        if (position < end &&
+            line_view(position, next_line(position, end)).find("configuration=") == std::string_view::npos) {
+            bool first = xdatcar_header->counts.empty();
+            position = parse_xdatcar_header(position, end, *xdatcar_header);
+            if (first && position) {
+                logXDATCARSpecies();
+            }
+        }
+        if (position) {
+            frame_status_t status;
+            position = parse_xdatcar_frame(position, end, *xdatcar_header, current, number_of_atoms, skip, status,
+                                           activeSelection());
+            if (!report_frame_status(status, current.time_step_id, number_of_atoms)) {
+                throw std::runtime_error("Inconsistent number of atoms at frame " +
+                                         std::to_string(current.time_step_id));
+            }
+        }
+        if (position == nullptr) {
+            cursor = end;
+            return false;
+        }
+        cursor = position;
+        if (!skip) {
+            selectAtoms(current);
+        }
+        return true;
+    }
+
+    void trajectoryReader::logXDATCARSpecies() const {
+        for (size_t i = 0; i < xdatcar_header->counts.size(); i++) {
+            auto name = i < xdatcar_header->species.size() ? xdatcar_header->species[i] : std::string("-");
+            LOGGER.info << "Atom type " << i + 1 << ": " << name << " (" << xdatcar_header->counts[i] << " atoms)"
+                        << std::endl;
+        }
+    }
+
+    std::vector<frame> trajectoryReader::readMappedXDATCARTrajectory() {
+
+        auto begin = mapped_file->begin();
+        auto end = mapped_file->end();
+        if (parse_xdatcar_header(begin, end, *xdatcar_header) == nullptr) {
+            LOGGER.error << "Cannot read the XDATCAR header of " << file_name << std::endl;
+            throw std::runtime_error("Cannot read the XDATCAR header of " + file_name);
+        }
+        logXDATCARSpecies();
+        number_of_atoms = xdatcar_header->number_of_atoms();
+        std::vector<int> types;
+        for (size_t species = 0; species < xdatcar_header->counts.size(); species++) {
+            types.insert(types.end(), xdatcar_header->counts[species], static_cast<int>(species) + 1);
+        }
+        resolveSelection(types);
+        auto frame_selection = activeSelection();
+
+        // Boundary scan, then every selected configuration is parsed concurrently in its own slot.
+        auto frames = find_xdatcar_frames(begin, end);
+        int header_lines = 0;
+        if (frames.size() > 1) {
+            auto position = frames[0];
+            for (int i = 0; i <= number_of_atoms; i++) { position = next_line(position, end); }
+            // A variable cell run has a header between the configurations, as many lines as the first one.
+            if (position != frames[1]) {
+                for (position = begin; position < frames[0]; position = next_line(position, end)) { header_lines++; }
+            }
+        }
+
+        auto n = selected_frames(frames.size(), start_iteration, delta_iteration, end_iteration);
+        std::vector<frame> trajectory(n);
+        std::vector<char> complete(n, false);
+        std::vector<frame_status_t> status(n);
+#pragma omp parallel for schedule(dynamic)
+        for (size_t i = 0; i < n; i++) {
+            auto position = frames[start_iteration + i * delta_iteration];
+            int expected_atoms = number_of_atoms;
+            if (header_lines > 0) {
+                xdatcar_header_t cell;
+                if (parse_xdatcar_header(previous_lines(begin, position, header_lines), end, cell) == nullptr) {
+                    continue;
+                }
+                complete[i] = parse_xdatcar_frame(position, end, cell, trajectory[i], expected_atoms, false,
+                                                  status[i], frame_selection) != nullptr;
+            } else {
+                complete[i] = parse_xdatcar_frame(position, end, *xdatcar_header, trajectory[i], expected_atoms,
+                                                  false, status[i], frame_selection) != nullptr;
+            }
+        }
+
+        // Drop a truncated configuration (e.g. a run still being written) and everything after it.
+        auto parsed = static_cast<size_t>(std::find(complete.begin(), complete.end(), false) - complete.begin());
+        // What the workers found is reported here, up to the first configuration that is not complete.
+        for (size_t i = 0; i < std::min(parsed + 1, n); i++) {
+            if (!report_frame_status(status[i], trajectory[i].time_step_id, number_of_atoms)) {
+                throw std::runtime_error("Inconsistent number of atoms at frame " +
+                                         std::to_string(trajectory[i].time_step_id));
+            }
+        }
+        trajectory.resize(parsed);
+        frame_id = static_cast<long>(frames.size());
+        cursor = end;
+        logReadingRate();
+
+        return trajectory;
+    }
+
+    void trajectoryReader::setXTCFrame(frame &current, int step, const matrix box, const std::vector<float> &x) const {
+        current.resize(selection.size(number_of_atoms));
+        current.time_step_id = step;
+        // Same convention as gro frames: box scaled positions, unwrapped and converted back by the caller.
+        current.scaled = true;
+        current.lattice[X] = {0, box[0][0]};
+        current.lattice[Y] = {0, box[1][1]};
+        current.lattice[Z] = {0, box[2][2]};
+        for (size_t slot = 0; slot < current.number_of_atoms; slot++) {
+            auto atom_id = selection.index(slot);
+            current.position_x[slot] = x[3 * atom_id] / box[0][0];
+            current.position_y[slot] = x[3 * atom_id + 1] / box[1][1];
+            current.position_z[slot] = x[3 * atom_id + 2] / box[2][2];
+            current.atom_type[slot] = atom_type[atom_id];
+        }
+    }
+
+    bool trajectoryReader::readXTCFrame(frame &current, bool skip) {
+
+        if (xdr == nullptr) {
+            atom_type = getAtomTypeFromGro();
+            unsigned long number_of_frames;
+            int64_t *offsets = nullptr;
+            if (read_xtc_header(file_name.c_str(), &number_of_atoms, &number_of_frames, &offsets) != exdrOK) {
+                LOGGER.error << "Failed to read number of atoms from" << file_name << std::endl;
+                throw std::runtime_error("Failed to read number of atoms from " + file_name);
+            }
+            setXDRFrameIndex(offsets, number_of_frames);
+            if (atom_type.size() != number_of_atoms) {
+                LOGGER.error << "Inconsistent number of atoms in gro coordinates file" << std::endl;
+                LOGGER.error << "Found:" << atom_type.size() << " expecting:" << number_of_atoms << std::endl;
+                throw std::runtime_error("Inconsistent number of atoms in gro coordinates file");
+            }
+            resolveSelection(atom_type);
+            xdr = xdrfile_open(file_name.c_str(), "r");
+            if (!xdr) {
+                LOGGER.error << "Cannot open XTC file" << std::endl;
+                return false;
+            }
+            coordinates.resize(3 * number_of_atoms);
+        }
+        if (skip) {
+            return skipXTCFrame(current);
+        }
+
+        matrix box;
+        int step;
+        float time, precision;
+        if (read_xtc(xdr, number_of_atoms, &step, &time, box, reinterpret_cast<rvec *>(coordinates.data()),
+                     &precision) != exdrOK) {
+            return false;
+        }
+        setXTCFrame(current, step, box, coordinates);
+        return true;
     }
 
-    std::vector<atom_t> trajectoryReader::getXTCTrajectory(double time_step, int start_iteration, int delta_iteration, int end_iteration) {
-        return std::vector<atom_t>();
+    std::vector<frame> trajectoryReader::readXTCTrajectory() {
+
+        atom_type = getAtomTypeFromGro();
+
+        unsigned long number_of_frames;
+        int64_t *offsets = nullptr;
+        if (read_xtc_header(file_name.c_str(), &number_of_atoms, &number_of_frames, &offsets) != exdrOK) {
+            LOGGER.error << "Failed to read number of atoms from" << file_name << std::endl;
+            exit(-1);
+        }
+        if (atom_type.size() != number_of_atoms) {
+            LOGGER.error << "Inconsistent number of atoms in gro coordinates file" << std::endl;
+            LOGGER.error << "Found:" << atom_type.size() << " expecting:" << number_of_atoms << std::endl;
+            exit(-1);
+        }
+        resolveSelection(atom_type);
+
+        auto n = selected_frames(number_of_frames, start_iteration, delta_iteration, end_iteration);
+        std::vector<frame> trajectory(n);
+        std::vector<char> complete(n, false);
+
+        // Each thread decodes a contiguous range of frames with its own file handle and buffers,
+        // the handles share one mapping of the file when it could be mapped.
+        XDRFILE *shared_xdr = xdrfile_open(file_name.c_str(), "r");
+#pragma omp parallel
+        {
+            XDRFILE *thread_xdr = xdrfile_dup(shared_xdr);
+            if (thread_xdr == nullptr) {
+                thread_xdr = xdrfile_open(file_name.c_str(), "r");
+            }
+            std::vector<float> x(3 * number_of_atoms);
+            matrix box;
+            int step;
+            float time, precision;
+#pragma omp for schedule(static)
+            for (size_t i = 0; i < n; i++) {
+                if (thread_xdr == nullptr ||
+                    xdr_seek(thread_xdr, offsets[start_iteration + i * delta_iteration], SEEK_SET) != exdrOK ||
+                    read_xtc(thread_xdr, number_of_atoms, &step, &time, box, reinterpret_cast<rvec *>(x.data()),
+                             &precision) != exdrOK) {
+                    continue;
+                }
+                setXTCFrame(trajectory[i], step, box, x);
+                complete[i] = true;
+            }
+            if (thread_xdr) {
+                xdrfile_close(thread_xdr);
+            }
+        }
+        if (shared_xdr) {
+            xdrfile_close(shared_xdr);
+        }
+        free(offsets);
+
+        trajectory.resize(std::find(complete.begin(), complete.end(), false) - complete.begin());
+        if (trajectory.size() < n) {
+            LOGGER.warning << "Failed to read XTC frame " << start_iteration + trajectory.size() * delta_iteration
+                           << ", keeping the previous " << trajectory.size() << " frames" << std::endl;
+        }
+        frame_id = static_cast<long>(number_of_frames);
+        logReadingRate();
+
+        return trajectory;
     }
 
 
@@ -236,13 +981,20 @@ namespace mdtools {
         return result;
     }
 
+    int trajectoryReader::getAtomTypeFromGroLine(const std::string &line) {
+        std::string atom_key = line.substr(9, 6);
+        auto item = map_atom_id.find(atom_key);
+        if (item == map_atom_id.end()) {
+            item = map_atom_id.insert({atom_key, static_cast<int>(map_atom_id.size()) + 1}).first;
+        }
+        return item->second;
+    }
+
     std::vector<int> trajectoryReader::getAtomTypeFromGro(){
         std::vector<int> result;
         std::string line;
         int count=0;
-        int atom_id=1;
         unsigned long number_of_atoms=0;
-        std::map<std::string , int> map_atom_id;
         while (std::getline(*input_stream, line)) {
             if(count ==0){ count++; continue;}
             if(count ==1){ number_of_atoms=stoi(line) ;count++; continue;}
@@ -252,30 +1004,98 @@ namespace mdtools {
                 continue;
             }
 
-            std::string atom_key=line.substr(9, 6);
-            if(map_atom_id.find(atom_key) == map_atom_id.end()){
-                map_atom_id[atom_key]=atom_id;
-                atom_id++;
-            }
-            result.push_back(map_atom_id[atom_key]);
+            result.push_back(getAtomTypeFromGroLine(line));
             count++;
         }
 
         if(result.size()!=number_of_atoms){
             LOGGER.warning << "Inconsistent number of atoms " << std::endl;
             LOGGER.warning << "Found:" << result.size() << " expecting:" << number_of_atoms << std::endl;
-            exit(-1);
+            throw std::runtime_error("Inconsistent number of atoms in gro coordinates file");
         }
 
         return result;
         }
 
+    bool trajectoryReader::readTRRFrame(frame &current, bool skip) {
+
+        if (xdr == nullptr) {
+            atom_type = getAtomTypeFromGro();
+            unsigned long number_of_frames;
+            int64_t *offsets = nullptr;
+            if (read_trr_header(file_name.c_str(), &number_of_atoms, &number_of_frames, &offsets) != exdrOK) {
+                LOGGER.error << "Failed to read number of atoms from" << file_name << std::endl;
+                throw std::runtime_error("Failed to read number of atoms from " + file_name);
+            }
+            setXDRFrameIndex(offsets, number_of_frames);
+            if (atom_type.size() != number_of_atoms) {
+                LOGGER.error << "Inconsistent number of atoms in gro coordinates file" << std::endl;
+                LOGGER.error << "Found:" << atom_type.size() << " expecting:" << number_of_atoms << std::endl;
+                throw std::runtime_error("Inconsistent number of atoms in gro coordinates file");
+            }
+            resolveSelection(atom_type);
+            xdr = xdrfile_open(file_name.c_str(), "r");
+            if (!xdr) {
+                LOGGER.error << "Cannot open TRR file" << std::endl;
+                return false;
+            }
+            trr = trr_context_create();
+            coordinates.resize(3 * number_of_atoms);
+        }
+
+        matrix box;
+        int step;
+        float time, lambda;
+        uint8_t flag = 0;
+        // A skipped frame only decodes the header and the box, every block is seeked over. The stored velocities
+        // are decoded for a module that derives them, as get() does (e.g. segmented input of PhononDOS).
+        bool velocities = !skip && read_velocities && (derived_fields & VELOCITIES);
+        if (velocities) {
+            trr_velocities.resize(3 * number_of_atoms);
+        }
+        trr_context_set_fields(trr, skip ? 0 : TRR_HAS_POSITIONS | (velocities ? TRR_HAS_VELOCITIES : 0));
+        if (read_trr_context(trr, xdr, number_of_atoms, &step, &time, &lambda, box,
+                             reinterpret_cast<rvec *>(coordinates.data()),
+                             velocities ? reinterpret_cast<rvec *>(trr_velocities.data()) : nullptr, nullptr,
+                             &flag) != exdrOK) {
+            return false;
+        }
+        if (skip) {
+            current.time_step_id = step;
+            return true;
+        }
+
+        current.resize(selection.size(number_of_atoms));
+        current.time_step_id = step;
+        current.scaled = false;
+        current.lattice[X] = {0, box[0][0]};
+        current.lattice[Y] = {0, box[1][1]};
+        current.lattice[Z] = {0, box[2][2]};
+        for (size_t slot = 0; slot < current.number_of_atoms; slot++) {
+            auto atom_id = selection.index(slot);
+            current.position_x[slot] = coordinates[3 * atom_id];
+            current.position_y[slot] = coordinates[3 * atom_id + 1];
+            current.position_z[slot] = coordinates[3 * atom_id + 2];
+            current.atom_type[slot] = atom_type[atom_id];
+        }
+        current.resize_velocities(velocities && (flag & TRR_HAS_VELOCITIES));
+        if (current.has_velocities()) {
+            for (size_t slot = 0; slot < current.number_of_atoms; slot++) {
+                auto atom_id = selection.index(slot);
+                current.velocity_x[slot] = trr_velocities[3 * atom_id];
+                current.velocity_y[slot] = trr_velocities[3 * atom_id + 1];
+                current.velocity_z[slot] = trr_velocities[3 * atom_id + 2];
+            }
+        }
+
+        return true;
+    }
 
-    std::vector<atom_t> trajectoryReader::getTRRTrajectory(double time_step, int start_iteration, int delta_iteration, int end_iteration) {
+    template<class T>
+    basic_trajectory_t<T> trajectoryReader::getTRRTrajectory(double time_step) {
 
-         std::vector<int> atom_type = getAtomTypeFromGro();
+        std::vector<int> atom_type = getAtomTypeFromGro();
 
-        std::vector<atom_t> atom_trajectory{};
         int number_of_atoms;
         unsigned long number_of_frames;
         int64_t* offsets = nullptr;
@@ -294,73 +1114,376 @@ namespace mdtools {
             LOGGER.warning << "Number of frames is smaller than simulation.end_iteration"<< std::endl;
         }
 
-        // Allocate arrays for coordinates and velocities
-        std::vector<float> coordinates(3 * number_of_atoms), velocity(3 * number_of_atoms);
-        matrix box;
-        int step;
-        float time, lambda;
-        XDRFILE* xdr = xdrfile_open(file_name.c_str(), "r");
-        if (!xdr) {
+        resolveSelection(atom_type);
+        auto number_of_selected = static_cast<int>(selection.size(number_of_atoms));
+
+        XDRFILE* shared_xdr = xdrfile_open(file_name.c_str(), "r");
+        if (!shared_xdr) {
             LOGGER.error << "Cannot open TRR file" << std::endl;
-            return atom_trajectory;
-        }
-
-        number_of_frames=std::min(number_of_frames,static_cast<unsigned long>(end_iteration-start_iteration));
-
-        atom_trajectory.resize(number_of_atoms);
-        for (auto & atom : atom_trajectory) {
-            atom.time_step = time_step;
-            atom.position_x.resize(number_of_frames);
-            atom.position_y.resize(number_of_frames);
-            atom.position_z.resize(number_of_frames);
-            atom.velocity_x.resize(number_of_frames);
-            atom.velocity_y.resize(number_of_frames);
-            atom.velocity_z.resize(number_of_frames);
-            atom.lattice_a.resize(number_of_frames);
-            atom.lattice_b.resize(number_of_frames);
-            atom.lattice_c.resize(number_of_frames);
-            atom.lattice_origin_x.resize(number_of_frames);
-            atom.lattice_origin_y.resize(number_of_frames);
-            atom.lattice_origin_z.resize(number_of_frames);
-            atom.time.resize(number_of_frames);
-        }
-        unsigned long frame_id=0;
-        int status;
-        uint8_t flag = 0;
-        while ((status = read_trr(xdr, number_of_atoms, &step, &time, &lambda,
-                                  box,                         // simulation box (3x3 matrix)
-                                  reinterpret_cast<rvec*>(coordinates.data()),  // coords array
-                                  reinterpret_cast<rvec*>(velocity.data()),    // velocities array
-                                  nullptr, &flag)) == exdrOK and frame_id < end_iteration) {
-            if(frame_id >= start_iteration && frame_id%delta_iteration == 0){
-                for(int atom_id=0; atom_id < number_of_atoms; atom_id++){
-                    atom_trajectory[atom_id].position_x[frame_id-start_iteration]=coordinates[3 * atom_id];
-                    atom_trajectory[atom_id].position_y[frame_id-start_iteration]=coordinates[3 * atom_id + 1];
-                    atom_trajectory[atom_id].position_z[frame_id-start_iteration]=coordinates[3 * atom_id + 2];
-                    atom_trajectory[atom_id].velocity_x[frame_id-start_iteration]=velocity[3 * atom_id];
-                    atom_trajectory[atom_id].velocity_y[frame_id-start_iteration]=velocity[3 * atom_id + 1];
-                    atom_trajectory[atom_id].velocity_z[frame_id-start_iteration]=velocity[3 * atom_id + 2];
-                    atom_trajectory[atom_id].lattice_origin_x[frame_id-start_iteration]=0;
-                    atom_trajectory[atom_id].lattice_origin_y[frame_id-start_iteration]=0;
-                    atom_trajectory[atom_id].lattice_origin_z[frame_id-start_iteration]=0;
-                    atom_trajectory[atom_id].lattice_a[frame_id-start_iteration]=box[0][0];
-                    atom_trajectory[atom_id].lattice_b[frame_id-start_iteration]=box[1][1];
-                    atom_trajectory[atom_id].lattice_c[frame_id-start_iteration]=box[2][2];
-                    atom_trajectory[atom_id].time[frame_id-start_iteration]=step*time_step;
-                    atom_trajectory[atom_id].atom_type=atom_type[atom_id];
+            free(offsets);
+            return {};
+        }
+
+        number_of_frames = selected_frames(number_of_frames, start_iteration, delta_iteration, end_iteration);
+
+        basic_trajectory_t<T> atom_trajectory(number_of_selected, number_of_frames, time_step);
+        if (read_velocities) {
+            atom_trajectory.allocate_velocities();
+        }
+        for (int slot = 0; slot < number_of_selected; slot++) {
+            atom_trajectory.atom_type(slot) = atom_type[selection.index(slot)];
+        }
+
+        // Same scheme as the XTC reader: each thread seeks to the selected frames of a contiguous range with its
+        // own handle and trr_context, and scatters them into their column of the atom series.
+        std::vector<char> complete(number_of_frames, false);
+#pragma omp parallel
+        {
+            XDRFILE *thread_xdr = xdrfile_dup(shared_xdr);
+            if (thread_xdr == nullptr) {
+                thread_xdr = xdrfile_open(file_name.c_str(), "r");
+            }
+            trr_context *context = trr_context_create();
+            trr_context_set_fields(context, TRR_HAS_POSITIONS | (read_velocities ? TRR_HAS_VELOCITIES : 0));
+            std::vector<float> coordinates(3 * number_of_atoms), velocity(3 * number_of_atoms);
+            matrix box;
+            int step;
+            float time, lambda;
+            uint8_t flag = 0;
+#pragma omp for schedule(static)
+            for (unsigned long slot = 0; slot < number_of_frames; slot++) {
+                if (thread_xdr == nullptr || context == nullptr ||
+                    xdr_seek(thread_xdr, offsets[start_iteration + slot * delta_iteration], SEEK_SET) != exdrOK ||
+                    read_trr_context(context, thread_xdr, number_of_atoms, &step, &time, &lambda,
+                                     box,                         // simulation box (3x3 matrix)
+                                     reinterpret_cast<rvec*>(coordinates.data()),  // coords array
+                                     reinterpret_cast<rvec*>(velocity.data()),    // velocities array
+                                     nullptr, &flag) != exdrOK) {
+                    continue;
+                }
+                atom_trajectory.box(slot).set(step * time_step, {0, 0, 0}, {box[0][0], box[1][1], box[2][2]});
+                auto current = atom_trajectory.frame(slot);
+                for(int atom_slot=0; atom_slot < number_of_selected; atom_slot++){
+                    auto atom_id = selection.index(atom_slot);
+                    current.position_x[atom_slot]=coordinates[3 * atom_id];
+                    current.position_y[atom_slot]=coordinates[3 * atom_id + 1];
+                    current.position_z[atom_slot]=coordinates[3 * atom_id + 2];
+                    if (read_velocities) {
+                        current.velocity_x[atom_slot]=velocity[3 * atom_id];
+                        current.velocity_y[atom_slot]=velocity[3 * atom_id + 1];
+                        current.velocity_z[atom_slot]=velocity[3 * atom_id + 2];
+                    }
+                }
+                complete[slot] = true;
+            }
+            trr_context_free(context);
+            if (thread_xdr) {
+                xdrfile_close(thread_xdr);
+            }
+        }
+        xdrfile_close(shared_xdr);
+        free(offsets);
+
+        // Drop a truncated frame and everything after it.
+        auto kept = static_cast<size_t>(std::find(complete.begin(), complete.end(), false) - complete.begin());
+        if (kept < number_of_frames) {
+            LOGGER.warning << "Failed to read TRR frame " << start_iteration + kept * delta_iteration
+                           << ", keeping the previous " << kept << " frames" << std::endl;
+        }
+
+        atom_trajectory.truncate(kept);
+
+        return atom_trajectory;
+    }
+
+    namespace {
+        template<class T>
+        void load_cache_column(const char *column, const atomSelection &selection, std::valarray<double> &position) {
+            auto values = reinterpret_cast<const T *>(column);
+            for (size_t i = 0; i < position.size(); i++) { position[i] = values[selection.index(i)]; }
+        }
+
+        template<class T, class S>
+        void load_cache_slot(const char *column, const atomSelection &selection, int first, int last, size_t slot,
+                             basic_trajectory_t<S> &atoms, field_t position) {
+            auto values = reinterpret_cast<const T *>(column);
+            for (int atom_id = first; atom_id < last; atom_id++) {
+                atoms.data(position, atom_id)[slot] = values[selection.index(atom_id)];
+            }
+        }
+    }
+
+    bool trajectoryReader::readCacheFrame(frame &current, bool skip) {
+        auto frames_begin = mapped_file->begin() + cache->frame_offset;
+        auto id = static_cast<size_t>(cursor - frames_begin) / cache->frame_stride;
+        if (id >= cache->number_of_frames) {
+            return false;
+        }
+        auto &box = reinterpret_cast<const cache_box_t *>(mapped_file->begin() + cache->box_offset)[id];
+        current.time_step_id = static_cast<int>(box.time_step_id);
+        if (!skip) {
+            current.resize(selection.size(number_of_atoms));
+            current.scaled = true;
+            for (int c = X; c <= Z; c++) { current.lattice[c] = {box.minimum[c], box.maximum[c]}; }
+            auto types = reinterpret_cast<const int32_t *>(mapped_file->begin() + cache->atom_type_offset);
+            for (size_t slot = 0; slot < current.number_of_atoms; slot++) {
+                current.atom_type[slot] = types[selection.index(slot)];
+            }
+            auto column_size = cache->frame_stride / 3;
+            std::valarray<double> *columns[3] = {&current.position_x, &current.position_y, &current.position_z};
+            for (int c = X; c <= Z; c++) {
+                if (cache->value_size == sizeof(float)) {
+                    load_cache_column<float>(cursor + c * column_size, selection, *columns[c]);
+                } else {
+                    load_cache_column<double>(cursor + c * column_size, selection, *columns[c]);
                 }
             }
-            frame_id++;
         }
+        cursor += cache->frame_stride;
+        return true;
+    }
 
-        for(auto &atom : atom_trajectory){
-            atom.calculate_means();
+    template<class T>
+    basic_trajectory_t<T> trajectoryReader::getCacheTrajectory(double time_step) {
+
+        auto n = selected_frames(cache->number_of_frames, start_iteration, delta_iteration, end_iteration);
+        if (n == 0) {
+            return {};
         }
+        auto base = mapped_file->begin();
+        auto boxes = reinterpret_cast<const cache_box_t *>(base + cache->box_offset);
+        auto types = reinterpret_cast<const int32_t *>(base + cache->atom_type_offset);
+        auto column_size = cache->frame_stride / 3;
 
-        xdrfile_close(xdr);
+        constexpr field_t positions[3] = {field_t::POSITION_X, field_t::POSITION_Y, field_t::POSITION_Z};
+        auto number_of_selected = static_cast<int>(selection.size(number_of_atoms));
+        basic_trajectory_t<T> atom_trajectory(number_of_selected, n, time_step);
+        for (size_t slot = 0; slot < n; slot++) {
+            auto &box = boxes[start_iteration + slot * delta_iteration];
+            atom_trajectory.box(slot).set(box.time_step_id * time_step, box.minimum, box.maximum);
+        }
+        // Frame blocks are transposed a group of atoms at a time, each frame contributes a contiguous run
+        // (a gather when only some atoms are selected).
+        constexpr int atoms_per_group = 1024;
+        int number_of_groups = (number_of_selected + atoms_per_group - 1) / atoms_per_group;
+#pragma omp parallel for schedule(dynamic)
+        for (int group = 0; group < number_of_groups; group++) {
+            int first = group * atoms_per_group;
+            int last = std::min(first + atoms_per_group, number_of_selected);
+            for (int atom_id = first; atom_id < last; atom_id++) {
+                atom_trajectory.atom_type(atom_id) = types[selection.index(atom_id)];
+            }
+            for (size_t slot = 0; slot < n; slot++) {
+                auto frame_id = start_iteration + slot * delta_iteration;
+                auto block = base + cache->frame_offset + frame_id * cache->frame_stride;
+                for (int c = X; c <= Z; c++) {
+                    if (cache->value_size == sizeof(float)) {
+                        load_cache_slot<float>(block + c * column_size, selection, first, last, slot, atom_trajectory,
+                                               positions[c]);
+                    } else {
+                        load_cache_slot<double>(block + c * column_size, selection, first, last, slot, atom_trajectory,
+                                                positions[c]);
+                    }
+                }
+            }
+        }
+        atom_trajectory.scaled = true;
+        frame_id = static_cast<long>(cache->number_of_frames);
+        cursor = base + cache->box_offset;
+        logReadingRate();
 
         return atom_trajectory;
     }
 
-    trajectoryReader::~trajectoryReader() = default;
+    long trajectoryReader::writeCache(const std::string &cache_file_name, int start_iteration, int delta_iteration,
+                                      int end_iteration, bool single_precision) {
+        begin(start_iteration, delta_iteration, end_iteration);
+        trajectoryCacheWriter writer(cache_file_name, single_precision);
+        frame current;
+        long number_of_frames = 0;
+        while (readNext(current)) {
+            writer.write(current);
+            number_of_frames++;
+        }
+        return writer.close() ? number_of_frames : -1;
+    }
+
+    std::unique_ptr<trajectoryReader> trajectoryReader::openSegment(size_t segment) const {
+        auto options = segment_options;
+        options.trajectory_input_file = segments[segment];
+        auto reader = std::make_unique<trajectoryReader>(options);
+        reader->readVelocities(read_velocities);
+        reader->derive(derived_fields);
+        return reader;
+    }
+
+    bool trajectoryReader::overlapsNextSegment(size_t segment, int time_step_id) const {
+        // A restarted run starts again from an earlier step, the frames from there on are read from the restart.
+        // Segments whose steps start again from zero (or have none) are only concatenated.
+        if (segment + 1 >= segment_first_step.size()) {
+            return false;
+        }
+        auto next_first_step = segment_first_step[segment + 1];
+        return next_first_step > segment_first_step[segment] && time_step_id >= next_first_step;
+    }
+
+    std::vector<int> trajectoryReader::scanTimeSteps() {
+        std::vector<int> steps;
+        frame current;
+        while ((this->*readFrame)(current, true)) {
+            steps.push_back(current.time_step_id);
+        }
+        return steps;
+    }
+
+    namespace {
+        // An exception must not escape an OpenMP region: each segment keeps its own, the first is rethrown after.
+        void rethrow_first(const std::vector<std::exception_ptr> &errors) {
+            for (auto &error : errors) {
+                if (error) { std::rethrow_exception(error); }
+            }
+        }
+    }
+
+    bool trajectoryReader::readSegmentFrame(frame &current, bool skip) {
+        if (segment_first_step.empty()) {
+            segment_first_step.resize(segments.size(), std::numeric_limits<int>::min());
+            std::vector<std::exception_ptr> errors(segments.size());
+#pragma omp parallel for schedule(dynamic)
+            for (size_t segment = 0; segment < segments.size(); segment++) {
+                try {
+                    auto reader = openSegment(segment);
+                    frame first;
+                    if ((reader.get()->*reader->readFrame)(first, true)) {
+                        segment_first_step[segment] = first.time_step_id;
+                    }
+                } catch (...) {
+                    errors[segment] = std::current_exception();
+                }
+            }
+            rethrow_first(errors);
+        }
+        while (segment_id < segments.size()) {
+            if (!segment_reader) {
+                segment_reader = openSegment(segment_id);
+            }
+            if ((segment_reader.get()->*segment_reader->readFrame)(current, skip) &&
+                !overlapsNextSegment(segment_id, current.time_step_id)) {
+                return true;
+            }
+            segment_reader.reset();
+            segment_id++;
+        }
+        return false;
+    }
+
+    std::vector<frame> trajectoryReader::readSegmentTrajectory() {
+
+        // Time steps of every frame, each segment is scanned on its own thread.
+        std::vector<std::vector<int>> steps(segments.size());
+        std::vector<std::exception_ptr> errors(segments.size());
+#pragma omp parallel for schedule(dynamic)
+        for (size_t segment = 0; segment < segments.size(); segment++) {
+            try {
+                steps[segment] = openSegment(segment)->scanTimeSteps();
+            } catch (...) {
+                errors[segment] = std::current_exception();
+            }
+        }
+        rethrow_first(errors);
+        segment_first_step.assign(segments.size(), std::numeric_limits<int>::min());
+        for (size_t segment = 0; segment < segments.size(); segment++) {
+            if (!steps[segment].empty()) { segment_first_step[segment] = steps[segment].front(); }
+        }
+
+        // Frames of the logical trajectory: segment_begin[k] is the first one of segment k.
+        std::vector<long> segment_begin(segments.size() + 1, 0);
+        size_t overlap = 0;
+        for (size_t segment = 0; segment < segments.size(); segment++) {
+            auto &segment_steps = steps[segment];
+            auto kept = std::find_if(segment_steps.begin(), segment_steps.end(), [&](int step) {
+                return overlapsNextSegment(segment, step);
+            }) - segment_steps.begin();
+            overlap += segment_steps.size() - kept;
+            segment_begin[segment + 1] = segment_begin[segment] + kept;
+        }
+        if (overlap > 0) {
+            LOGGER.info << "Dropped " << overlap << " frames overlapping the next segment" << std::endl;
+        }
+
+        auto n = selected_frames(segment_begin.back(), start_iteration, delta_iteration, end_iteration);
+        std::vector<frame> trajectory(n);
+        std::vector<char> complete(n, false);
+
+        // Each segment reads its selected frames into their slot with its own reader.
+#pragma omp parallel for schedule(dynamic)
+        for (size_t segment = 0; segment < segments.size(); segment++) {
+            long slot = std::max(0L, (segment_begin[segment] - start_iteration + delta_iteration - 1) / delta_iteration);
+            long first_frame = start_iteration + slot * delta_iteration;
+            if (slot >= static_cast<long>(n) || first_frame >= segment_begin[segment + 1]) {
+                continue;
+            }
+            try {
+                auto reader = openSegment(segment);
+                reader->begin(static_cast<int>(first_frame - segment_begin[segment]), delta_iteration,
+                              static_cast<int>(segment_begin[segment + 1] - segment_begin[segment]));
+                for (; slot < static_cast<long>(n) && start_iteration + slot * delta_iteration < segment_begin[segment + 1];
+                       slot++) {
+                    auto &current = trajectory[slot];
+                    if (!reader->readNext(current)) {
+                        break;
+                    }
+                    // TRR frames are in nm, the atom trajectory is built from box fractions (or unwrapped nm).
+                    if (!current.scaled && !current.unwrapped) {
+                        current.position_x /= current.lattice[X].maximum;
+                        current.position_y /= current.lattice[Y].maximum;
+                        current.position_z /= current.lattice[Z].maximum;
+                        current.scaled = true;
+                    }
+                    complete[slot] = true;
+                }
+            } catch (...) {
+                errors[segment] = std::current_exception();
+            }
+        }
+        rethrow_first(errors);
+
+        trajectory.resize(std::find(complete.begin(), complete.end(), false) - complete.begin());
+        if (trajectory.size() < n) {
+            LOGGER.warning << "Failed to read frame " << start_iteration + trajectory.size() * delta_iteration
+                           << ", keeping the previous " << trajectory.size() << " frames" << std::endl;
+        }
+        frame_id = segment_begin.back();
+        logReadingRate();
+
+        return trajectory;
+    }
+
+    template<class T>
+    basic_trajectory_t<T> trajectoryReader::get(double time_step, int start_iteration, int delta_iteration, int end_iteration) {
+        begin(start_iteration, delta_iteration, end_iteration);
+        basic_trajectory_t<T> trajectory;
+        if (cache) {
+            trajectory = getCacheTrajectory<T>(time_step);
+        } else if (lammps_columns) {
+            trajectory = getLammpsTrajectory<T>(time_step);
+        } else if (readTrajectory == nullptr) {
+            trajectory = getTRRTrajectory<T>(time_step);
+        } else {
+            trajectory = getAtomTrajectory<T>((this->*readTrajectory)(), time_step);
+        }
+        trajectory.derive(derived_fields);
+        return trajectory;
+    }
+
+    template basic_trajectory_t<float> trajectoryReader::get<float>(double, int, int, int);
+    template basic_trajectory_t<double> trajectoryReader::get<double>(double, int, int, int);
+
+    trajectoryReader::~trajectoryReader() {
+        trr_context_free(trr);
+        if (xdr) {
+            xdrfile_close(xdr);
+        }
+        delete input_stream;
+    }
 } // mdtools
\ No newline at end of file
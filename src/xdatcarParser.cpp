@@ -0,0 +1,182 @@
+// MDTools
+//     Copyright (C)  2025  Pablo Galaviz
+//
+//     This program is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+//
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+//
+//     You should have received a copy of the GNU General Public License
+//     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//
+// Created by Pablo Galaviz on 16/10/2026.
+//
+
+#include "xdatcarParser.h"
+#include <algorithm>
+#include <cmath>
+
+namespace mdtools {
+
+    int xdatcar_header_t::number_of_atoms() const {
+        int result = 0;
+        for (auto count: counts) { result += count; }
+        return result;
+    }
+
+    const char *previous_lines(const char *begin, const char *position, int count) {
+        for (int i = 0; i < count && position > begin; i++) {
+            // Skip the end of line of the previous line, then find its beginning.
+            position--;
+            while (position > begin && position[-1] != '\n') { position--; }
+        }
+        return position;
+    }
+
+    std::vector<const char *> find_xdatcar_frames(const char *position, const char *end) {
+        constexpr std::string_view item = "configuration=";
+        std::vector<const char *> frames;
+        auto begin = position;
+        while (position < end) {
+            auto found = static_cast<const char *>(memmem(position, end - position, item.data(), item.size()));
+            if (found == nullptr) {
+                break;
+            }
+            auto line = found;
+            while (line > begin && line[-1] != '\n') { line--; }
+            frames.push_back(line);
+            position = next_line(found, end);
+        }
+        return frames;
+    }
+
+    const char *parse_xdatcar_header(const char *position, const char *end, xdatcar_header_t &header) {
+
+        // Title
+        position = next_line(position, end);
+        double scale;
+        if (position >= end || !parse_number(position, end, scale)) {
+            return nullptr;
+        }
+        position = next_line(position, end);
+        for (auto &vector: header.lattice) {
+            auto next = position;
+            for (auto &component: vector) {
+                if (!next || !(next = parse_number(next, end, component))) {
+                    return nullptr;
+                }
+            }
+            position = next_line(position, end);
+        }
+
+        // A negative scale is the volume of the cell.
+        if (scale < 0) {
+            auto &a = header.lattice;
+            double volume = a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1]) -
+                            a[0][1] * (a[1][0] * a[2][2] - a[1][2] * a[2][0]) +
+                            a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]);
+            scale = std::cbrt(-scale / std::abs(volume));
+        }
+        for (auto &vector: header.lattice) {
+            for (auto &component: vector) { component *= scale; }
+        }
+
+        // Species names are missing in vasp 4 files, the line holds the counts straight away.
+        auto line_end = next_line(position, end);
+        int count;
+        if (!parse_number(position, line_end, count)) {
+            header.species.clear();
+            auto line = line_view(position, line_end);
+            boost::algorithm::split(header.species, line, boost::is_space(), boost::token_compress_on);
+            header.species.erase(std::remove(header.species.begin(), header.species.end(), ""),
+                                 header.species.end());
+            position = line_end;
+            line_end = next_line(position, end);
+        }
+        header.counts.clear();
+        for (auto next = parse_number(position, line_end, count); next; next = parse_number(next, line_end, count)) {
+            header.counts.push_back(count);
+        }
+        if (header.counts.empty()) {
+            return nullptr;
+        }
+        return line_end;
+    }
+
+    const char *parse_xdatcar_frame(const char *position, const char *end, const xdatcar_header_t &header,
+                                    frame &current, int &number_of_atoms, bool skip, frame_status_t &status,
+                                    const atomSelection *selection) {
+
+        status.clear();
+        auto line_end = next_line(position, end);
+        auto line = line_view(position, line_end);
+        auto found = line.find("configuration=");
+        if (found == std::string_view::npos) {
+            return nullptr;
+        }
+        current.time_step_id = 0;
+        parse_number(position + found + 14, line_end, current.time_step_id);
+        // Cartesian blocks are in Angstrom, they are converted to fractions of the cell diagonal.
+        auto first = line.find_first_not_of(" \t");
+        bool cartesian = first != std::string_view::npos && (line[first] == 'C' || line[first] == 'c');
+        position = line_end;
+
+        int noa = header.number_of_atoms();
+        if (number_of_atoms == 0) {
+            number_of_atoms = noa;
+        } else {
+            if (number_of_atoms != noa) {
+                status.inconsistent = true;
+                status.found_atoms = noa;
+                return nullptr;
+            }
+        }
+        current.resize(selection ? selection->size(number_of_atoms) : number_of_atoms);
+        current.scaled = true;
+        // Only the diagonal of triclinic cells is used, converted to nm.
+        current.lattice[X] = {0, header.lattice[0][0] / 10};
+        current.lattice[Y] = {0, header.lattice[1][1] / 10};
+        current.lattice[Z] = {0, header.lattice[2][2] / 10};
+
+        int atom_id = 0;
+        for (size_t species = 0; species < header.counts.size(); species++) {
+            for (int i = 0; i < header.counts[species]; i++, atom_id++) {
+                if (position >= end) {
+                    return nullptr;
+                }
+                line_end = next_line(position, end);
+                long slot = selection ? selection->slot(atom_id) : atom_id;
+                if (skip || slot < 0) {
+                    position = line_end;
+                    continue;
+                }
+                double x, y, z;
+                auto next = parse_number(position, line_end, x);
+                if (next) { next = parse_number(next, line_end, y); }
+                if (next) { next = parse_number(next, line_end, z); }
+                if (!next) {
+                    return nullptr;
+                }
+                if (cartesian) {
+                    x /= header.lattice[0][0];
+                    y /= header.lattice[1][1];
+                    z /= header.lattice[2][2];
+                }
+                current.atom_type[slot] = static_cast<int>(species) + 1;
+                current.position_x[slot] = x;
+                current.position_y[slot] = y;
+                current.position_z[slot] = z;
+                position = line_end;
+            }
+        }
+
+        return position;
+    }
+
+}
@@ -38,6 +38,15 @@
 
 #include "xdrfile/xdrfile.h"
 
+/* Files opened for reading are memory mapped when the platform allows it. */
+#if (!defined HAVE_RPC_XDR_H && (defined __unix__ || defined __APPLE__))
+#define XDRFILE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 char* exdr_message[exdrNR] = {"OK",
                               "Header",
                               "String",
@@ -93,9 +102,12 @@ struct XDR {
         int (*x_putlong)(XDR* __xdrs, int32_t* __lp);
         int (*x_getbytes)(XDR* __xdrs, char* __addr, unsigned int __len);
         int (*x_putbytes)(XDR* __xdrs, char* __addr, unsigned int __len);
-        /* two next routines are not 64-bit IO safe - don't use! */
-        unsigned int (*x_getpostn)(XDR* __xdrs);
-        int (*x_setpostn)(XDR* __xdrs, unsigned int __pos);
+        /* decode __len consecutive longs, returns the number decoded */
+        unsigned int (*x_getlongs)(XDR* __xdrs, int32_t* __lp, unsigned int __len);
+        /* pointer to the next __len bytes without copying, NULL if not supported */
+        const char* (*x_inline)(XDR* __xdrs, unsigned int __len);
+        int64_t (*x_getpostn)(XDR* __xdrs);
+        int (*x_setpostn)(XDR* __xdrs, int64_t __pos, int __whence);
         void (*x_destroy)(XDR* __xdrs);
     } const* x_ops;
     void* x_private;
@@ -111,7 +123,16 @@ static int xdr_float(XDR* xdrs, float* ip);
 static int xdr_double(XDR* xdrs, double* ip);
 static int xdr_string(XDR* xdrs, char** ip, unsigned int maxsize);
 static int xdr_opaque(XDR* xdrs, char* cp, unsigned int cnt);
+static int xdr_getlongs(XDR* xdrs, int32_t* lp, int n);
+static int xdr_getdoubles(XDR* xdrs, double* dp, int n);
 static void xdrstdio_create(XDR* xdrs, FILE* fp, enum xdr_op xop);
+#ifdef XDRFILE_MMAP
+typedef struct xdrmem xdrmem;
+static xdrmem* xdrmem_map(int fd);
+static xdrmem* xdrmem_share(xdrmem* mem);
+static void xdrmem_unmap(xdrmem* mem);
+static void xdrmem_create(XDR* xdrs, xdrmem* mem);
+#endif
 
 /* #define xdr_getpos(xdrs) (*(xdrs)->x_ops->x_getpostn)(xdrs) */
 /* #define xdr_setpos(xdrs, pos) (*(xdrs)->x_ops->x_setpostn)(xdrs, pos) */
@@ -135,6 +156,7 @@ struct XDRFILE {
     int buf1size; /**< Current allocated length of buf1          */
     int* buf2;    /**< Buffer for internal use                   */
     int buf2size; /**< Current allocated length of buf2          */
+    struct xdrmem* mem; /**< Read only file mapping, NULL for stdio */
 };
 
 /*************************************************************
@@ -175,12 +197,52 @@ XDRFILE* xdrfile_open(const char* path, const char* mode) {
         return NULL;
     }
     xfp->mode = *mode;
-    xdrstdio_create((XDR*)(xfp->xdr), xfp->fp, xdrmode);
+    xfp->mem = NULL;
+#ifdef XDRFILE_MMAP
+    /* read from a mapping of the file, fall back to stdio if it cannot be mapped */
+    if (xdrmode == XDR_DECODE && (xfp->mem = xdrmem_map(fileno(xfp->fp))) != NULL) {
+        fclose(xfp->fp);
+        xfp->fp = NULL;
+        xdrmem_create((XDR*)(xfp->xdr), xfp->mem);
+    } else
+#endif
+        xdrstdio_create((XDR*)(xfp->xdr), xfp->fp, xdrmode);
     xfp->buf1 = xfp->buf2 = NULL;
     xfp->buf1size = xfp->buf2size = 0;
     return xfp;
 }
 
+XDRFILE* xdrfile_dup(XDRFILE* xfp) {
+#ifdef XDRFILE_MMAP
+    XDRFILE* dup;
+
+    if (xfp == NULL || xfp->mem == NULL) {
+        return NULL;
+    }
+    if ((dup = (XDRFILE*)malloc(sizeof(XDRFILE))) == NULL) {
+        return NULL;
+    }
+    if ((dup->xdr = (XDR*)malloc(sizeof(XDR))) == NULL) {
+        free(dup);
+        return NULL;
+    }
+    if ((dup->mem = xdrmem_share(xfp->mem)) == NULL) {
+        free(dup->xdr);
+        free(dup);
+        return NULL;
+    }
+    dup->fp = NULL;
+    dup->mode = xfp->mode;
+    xdrmem_create((XDR*)(dup->xdr), dup->mem);
+    dup->buf1 = dup->buf2 = NULL;
+    dup->buf1size = dup->buf2size = 0;
+    return dup;
+#else
+    (void)xfp;
+    return NULL;
+#endif
+}
+
 int xdrfile_close(XDRFILE* xfp) {
     int ret = exdrCLOSE;
     if (xfp) {
@@ -190,7 +252,13 @@ int xdrfile_close(XDRFILE* xfp) {
         }
         free(xfp->xdr);
         /* close the file */
-        ret = fclose(xfp->fp);
+#ifdef XDRFILE_MMAP
+        if (xfp->mem) {
+            xdrmem_unmap(xfp->mem);
+            ret = 0;
+        } else
+#endif
+            ret = fclose(xfp->fp);
         if (xfp->buf1size) {
             free(xfp->buf1);
         }
@@ -205,6 +273,11 @@ int xdrfile_close(XDRFILE* xfp) {
 int xdrfile_read_int(int* ptr, int ndata, XDRFILE* xfp) {
     int i = 0;
 
+#ifndef HAVE_RPC_XDR_H
+    if (sizeof(int) == sizeof(int32_t) && ((XDR*)(xfp->xdr))->x_op == XDR_DECODE) {
+        return xdr_getlongs((XDR*)(xfp->xdr), (int32_t*)ptr, ndata);
+    }
+#endif
     /* read write is encoded in the XDR struct */
     while (i < ndata && xdr_int((XDR*)(xfp->xdr), ptr + i)) {
         i++;
@@ -330,6 +403,11 @@ int xdrfile_write_ushort(unsigned short* ptr, int ndata, XDRFILE* xfp) {
 
 int xdrfile_read_float(float* ptr, int ndata, XDRFILE* xfp) {
     int i = 0;
+#ifndef HAVE_RPC_XDR_H
+    if (sizeof(float) == sizeof(int32_t) && ((XDR*)(xfp->xdr))->x_op == XDR_DECODE) {
+        return xdr_getlongs((XDR*)(xfp->xdr), (int32_t*)ptr, ndata);
+    }
+#endif
     /* read write is encoded in the XDR struct */
     while (i < ndata && xdr_float((XDR*)(xfp->xdr), ptr + i)) {
         i++;
@@ -348,6 +426,11 @@ int xdrfile_write_float(float* ptr, int ndata, XDRFILE* xfp) {
 
 int xdrfile_read_double(double* ptr, int ndata, XDRFILE* xfp) {
     int i = 0;
+#ifndef HAVE_RPC_XDR_H
+    if (2 * sizeof(int32_t) == sizeof(double) && ((XDR*)(xfp->xdr))->x_op == XDR_DECODE) {
+        return xdr_getdoubles((XDR*)(xfp->xdr), ptr, ndata);
+    }
+#endif
     /* read write is encoded in the XDR struct */
     while (i < ndata && xdr_double((XDR*)(xfp->xdr), ptr + i)) {
         i++;
@@ -655,6 +738,280 @@ static const int magicints[] = {
 /* note that magicints[FIRSTIDX-1] == 0 */
 #define LASTIDX (sizeof(magicints) / sizeof(*magicints))
 
+/*
+ * Optimised decoder for compressed coordinates, bit-exact with the reference
+ * implementation above (decodebits/decodeints). It differs in three places:
+ *  - bits are taken from a left-aligned 64-bit buffer refilled 8 bytes at a time,
+ *  - the small integer unpacking uses one 64-bit division (reciprocal multiply
+ *    for values up to 32 bits) instead of byte-wise long division,
+ *  - integers are stored in output order and scaled by inv_precision in a
+ *    separate loop that the compiler vectorises.
+ * Select it with xdrfile_set_fast_decompression() (enabled by default).
+ */
+
+static int fast_decompression = 1;
+
+void xdrfile_set_fast_decompression(int enable) { fast_decompression = enable; }
+
+typedef struct {
+    const unsigned char* ptr;
+    const unsigned char* end;
+    uint64_t bits;  /* valid bits are left aligned */
+    unsigned int count; /* number of valid bits */
+} bitreader;
+
+static void bitreader_refill(bitreader* br) {
+    if (br->end - br->ptr >= 8) {
+        const unsigned char* p = br->ptr;
+        uint64_t v = ((uint64_t)p[0] << 56) | ((uint64_t)p[1] << 48) | ((uint64_t)p[2] << 40) |
+                     ((uint64_t)p[3] << 32) | ((uint64_t)p[4] << 24) | ((uint64_t)p[5] << 16) |
+                     ((uint64_t)p[6] << 8) | (uint64_t)p[7];
+        br->bits |= v >> br->count;
+        br->ptr += (63 - br->count) >> 3;
+        br->count |= 56;
+    } else {
+        while (br->count <= 56 && br->ptr < br->end) {
+            br->bits |= (uint64_t)(*br->ptr++) << (56 - br->count);
+            br->count += 8;
+        }
+        /* past the end of the data the stream reads as zeros */
+        if (br->count < 56) {
+            br->count = 56;
+        }
+    }
+}
+
+/* Read num_of_bits (0-56) bits, most significant first, like decodebits. */
+static inline uint64_t bitreader_read(bitreader* br, unsigned int num_of_bits) {
+    uint64_t num;
+    if (num_of_bits == 0) {
+        return 0;
+    }
+    if (br->count < num_of_bits) {
+        bitreader_refill(br);
+    }
+    num = br->bits >> (64 - num_of_bits);
+    br->bits <<= num_of_bits;
+    br->count -= num_of_bits;
+    return num;
+}
+
+/* Unsigned division by a divisor fixed for many values. */
+typedef struct {
+    uint64_t divisor;
+    uint64_t multiplier; /* ceil(2^64 / divisor), exact for 32-bit dividends */
+} fastdiv;
+
+static void fastdiv_init(fastdiv* d, unsigned int divisor) {
+    d->divisor = divisor;
+    d->multiplier = divisor > 1 ? UINT64_C(0xFFFFFFFFFFFFFFFF) / divisor + 1 : 0;
+}
+
+static inline uint64_t fastdiv_divide(const fastdiv* d, uint64_t num, int small) {
+#ifdef __SIZEOF_INT128__
+    if (small && d->multiplier) {
+        return (uint64_t)(((unsigned __int128)d->multiplier * num) >> 64);
+    }
+#endif
+    (void)small;
+    return num / d->divisor;
+}
+
+/*
+ * Same result as decodeints(buf, 3, num_of_bits, sizes, nums): the bytes of the
+ * packed number come least significant first, each one read most significant bit first.
+ */
+static inline void bitreader_decodeints(bitreader* br, unsigned int num_of_bits, const fastdiv sizes[3],
+                                        int nums[3]) {
+    unsigned int full_bytes = (num_of_bits - 1) >> 3;
+    uint64_t num, q;
+    int small;
+
+    if (num_of_bits > 64) {
+        /* byte-wise long division, as the reference */
+        int bytes[32];
+        int i, j, num_of_bytes = 0;
+        unsigned int p, n;
+        bytes[1] = bytes[2] = bytes[3] = 0;
+        while (num_of_bits > 8) {
+            bytes[num_of_bytes++] = (int)bitreader_read(br, 8);
+            num_of_bits -= 8;
+        }
+        bytes[num_of_bytes++] = (int)bitreader_read(br, num_of_bits);
+        for (i = 2; i > 0; i--) {
+            n = 0;
+            for (j = num_of_bytes - 1; j >= 0; j--) {
+                n = (n << 8) | bytes[j];
+                p = n / (unsigned int)sizes[i].divisor;
+                bytes[j] = p;
+                n = n - p * (unsigned int)sizes[i].divisor;
+            }
+            nums[i] = n;
+        }
+        nums[0] = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (bytes[3] << 24);
+        return;
+    }
+
+    num = 0;
+    if (full_bytes > 0) {
+        /* whole bytes in one read, then put the first byte read in the lowest position */
+        uint64_t chunk = bitreader_read(br, full_bytes * 8);
+        unsigned int k;
+        for (k = 0; k < full_bytes; k++) {
+            num |= ((chunk >> (8 * (full_bytes - 1 - k))) & 0xff) << (8 * k);
+        }
+    }
+    num |= bitreader_read(br, num_of_bits - 8 * full_bytes) << (8 * full_bytes);
+
+    small = num_of_bits <= 32;
+    q = fastdiv_divide(&sizes[2], num, small);
+    nums[2] = (int)(num - q * sizes[2].divisor);
+    num = q;
+    q = fastdiv_divide(&sizes[1], num, small);
+    nums[1] = (int)(num - q * sizes[1].divisor);
+    nums[0] = (int)q;
+}
+
+#if defined(__GNUC__) && defined(__x86_64__) && !defined(__clang__)
+__attribute__((target_clones("avx2", "default")))
+#endif
+static void dequantize(float* out, const int* in, int n, float inv_precision) {
+    int i;
+    for (i = 0; i < n; i++) {
+        out[i] = in[i] * inv_precision;
+    }
+}
+
+/* Decode lsize compressed coordinates from data, see xdrfile_decompress_coord_float. */
+static int decompress_coord_float_fast(float* ptr, int lsize, float precision, const int minint[3],
+                                       const unsigned int sizeint[3], const unsigned int bitsizeint[3],
+                                       unsigned int bitsize, int smallidx, const unsigned char* data,
+                                       unsigned int num_of_bytes, int* ints) {
+    bitreader br;
+    fastdiv large[3], small[3];
+    int i, k, run, flag, is_smaller, smallnum, smaller, tmp;
+    int size3 = lsize * 3, out = 0;
+    int thiscoord[3], prevcoord[3];
+
+    if (smallidx < 0 || smallidx >= (int)LASTIDX || magicints[smallidx] == 0) {
+        fprintf(stderr, "Invalid size found in 'xdrfile_decompress_coord_float'.\n");
+        return -1;
+    }
+
+    br.ptr = data;
+    br.end = data + num_of_bytes;
+    br.bits = 0;
+    br.count = 0;
+
+    for (k = 0; k < 3; k++) {
+        fastdiv_init(&large[k], sizeint[k]);
+        fastdiv_init(&small[k], magicints[smallidx]);
+    }
+    tmp = smallidx - 1;
+    tmp = (FIRSTIDX > tmp) ? FIRSTIDX : tmp;
+    smaller = magicints[tmp] / 2;
+    smallnum = magicints[smallidx] / 2;
+
+    run = 0;
+    i = 0;
+    while (i < lsize) {
+        if (bitsize == 0) {
+            thiscoord[0] = (int)bitreader_read(&br, bitsizeint[0]);
+            thiscoord[1] = (int)bitreader_read(&br, bitsizeint[1]);
+            thiscoord[2] = (int)bitreader_read(&br, bitsizeint[2]);
+        } else {
+            bitreader_decodeints(&br, bitsize, large, thiscoord);
+        }
+
+        i++;
+        thiscoord[0] += minint[0];
+        thiscoord[1] += minint[1];
+        thiscoord[2] += minint[2];
+
+        prevcoord[0] = thiscoord[0];
+        prevcoord[1] = thiscoord[1];
+        prevcoord[2] = thiscoord[2];
+
+        flag = (int)bitreader_read(&br, 1);
+        is_smaller = 0;
+        if (flag == 1) {
+            run = (int)bitreader_read(&br, 5);
+            is_smaller = run % 3;
+            run -= is_smaller;
+            is_smaller--;
+        }
+        if (out + run > size3) {
+            fprintf(stderr, "Buffer overrun during decompression.\n");
+            return -1;
+        }
+        if (run > 0) {
+            for (k = 0; k < run; k += 3) {
+                bitreader_decodeints(&br, smallidx, small, thiscoord);
+                i++;
+                thiscoord[0] += prevcoord[0] - smallnum;
+                thiscoord[1] += prevcoord[1] - smallnum;
+                thiscoord[2] += prevcoord[2] - smallnum;
+                if (k == 0) {
+                    /* interchange first with second atom for better
+                     * compression of water molecules
+                     */
+                    ints[out++] = thiscoord[0];
+                    ints[out++] = thiscoord[1];
+                    ints[out++] = thiscoord[2];
+                    tmp = thiscoord[0];
+                    thiscoord[0] = prevcoord[0];
+                    prevcoord[0] = tmp;
+                    tmp = thiscoord[1];
+                    thiscoord[1] = prevcoord[1];
+                    prevcoord[1] = tmp;
+                    tmp = thiscoord[2];
+                    thiscoord[2] = prevcoord[2];
+                    prevcoord[2] = tmp;
+                } else {
+                    prevcoord[0] = thiscoord[0];
+                    prevcoord[1] = thiscoord[1];
+                    prevcoord[2] = thiscoord[2];
+                }
+                if (out + 3 > size3) {
+                    fprintf(stderr, "Buffer overrun during decompression.\n");
+                    return -1;
+                }
+                ints[out++] = thiscoord[0];
+                ints[out++] = thiscoord[1];
+                ints[out++] = thiscoord[2];
+            }
+        } else {
+            ints[out++] = thiscoord[0];
+            ints[out++] = thiscoord[1];
+            ints[out++] = thiscoord[2];
+        }
+        smallidx += is_smaller;
+        if (is_smaller < 0) {
+            smallnum = smaller;
+
+            if (smallidx > FIRSTIDX) {
+                smaller = magicints[smallidx - 1] / 2;
+            } else {
+                smaller = 0;
+            }
+        } else if (is_smaller > 0) {
+            smaller = smallnum;
+            smallnum = magicints[smallidx] / 2;
+        }
+        if (is_smaller != 0) {
+            if (smallidx < 0 || smallidx >= (int)LASTIDX || magicints[smallidx] == 0) {
+                fprintf(stderr, "Invalid size found in 'xdrfile_decompress_coord_float'.\n");
+                return -1;
+            }
+            for (k = 0; k < 3; k++) {
+                fastdiv_init(&small[k], magicints[smallidx]);
+            }
+        }
+    }
+    dequantize(ptr, ints, out, 1.0f / precision);
+    return lsize;
+}
+
 /* Compressed coordinate routines - modified from the original
  * implementation by Frans v. Hoesel to make them threadsafe.
  */
@@ -743,9 +1100,25 @@ int xdrfile_decompress_coord_float(float* ptr, int* size, float* precision, XDRF
     if (xdrfile_read_int(buf2, 1, xfp) == 0) {
         return 0;
     }
+#ifndef HAVE_RPC_XDR_H
+    /* decode straight from the file mapping when there is one */
+    if (fast_decompression && buf2[0] >= 0) {
+        XDR* xdrs = (XDR*)(xfp->xdr);
+        const char* data = (*xdrs->x_ops->x_inline)(xdrs, ((unsigned int)buf2[0] + 3) & ~3u);
+        if (data != NULL) {
+            return decompress_coord_float_fast(ptr, lsize, *precision, minint, sizeint, bitsizeint, bitsize,
+                                               smallidx, (const unsigned char*)data, (unsigned int)buf2[0], buf1);
+        }
+    }
+#endif
     if (xdrfile_read_opaque((char*)&(buf2[3]), (unsigned int)buf2[0], xfp) == 0) {
         return 0;
     }
+    if (fast_decompression) {
+        return decompress_coord_float_fast(ptr, lsize, *precision, minint, sizeint, bitsizeint, bitsize,
+                                           smallidx, (const unsigned char*)&(buf2[3]), (unsigned int)buf2[0],
+                                           buf1);
+    }
     buf2[0] = buf2[1] = buf2[2] = 0;
 
     lfp = ptr;
@@ -1678,6 +2051,60 @@ static int32_t xdr_ntohl(int x) {
     }
 }
 
+/* Byte swap n words in place. Written as a plain loop over independent
+ * elements so that the compiler turns it into a vector shuffle. */
+static void xdr_swapwords(uint32_t* p, size_t n) {
+    size_t i;
+    for (i = 0; i < n; i++) {
+        uint32_t x = p[i];
+        p[i] = (x >> 24) | ((x >> 8) & 0xff00u) | ((x << 8) & 0xff0000u) | (x << 24);
+    }
+}
+
+/* Decode n longs with a single call to the stream (one fread for stdio)
+ * instead of one call per element. Returns the number of longs decoded. */
+static int xdr_getlongs(XDR* xdrs, int32_t* lp, int n) {
+    int s = 0x1234;
+    unsigned int nread;
+
+    if (n <= 0) {
+        return 0;
+    }
+    nread = (*xdrs->x_ops->x_getlongs)(xdrs, lp, (unsigned int)n);
+    if (*((char*)&s) == (char)0x34) {
+        /* smallendian, swap bytes */
+        xdr_swapwords((uint32_t*)lp, nread);
+    }
+    return (int)nread;
+}
+
+/* Decode n doubles in bulk. XDR stores the most significant word first. */
+static int xdr_getdoubles(XDR* xdrs, double* dp, int n) {
+    double x = 0.987654321;
+    unsigned char ix = *((char*)&x);
+    uint32_t* lp = (uint32_t*)dp;
+    int i, nread;
+
+    if (n <= 0) {
+        return 0;
+    }
+    nread = xdr_getlongs(xdrs, (int32_t*)dp, 2 * n) / 2;
+    if (ix == 0xb8 || ix == 0x3c) {
+        /* small endian word order, swap words */
+        for (i = 0; i < nread; i++) {
+            uint32_t tmp = lp[2 * i];
+            lp[2 * i] = lp[2 * i + 1];
+            lp[2 * i + 1] = tmp;
+        }
+    } else if (ix != 0xdd && ix != 0x3f) {
+        fprintf(stderr, "Cannot detect floating-point word order.\n"
+                        "Do you have a non-IEEE system?\n"
+                        "Use system XDR libraries or fix xdr_double().\n");
+        abort();
+    }
+    return nread;
+}
+
 static int xdr_int(XDR* xdrs, int* ip) {
     int32_t i32;
 
@@ -2002,9 +2429,11 @@ static int xdr_double(XDR* xdrs, double* dp) {
 }
 
 static int xdrstdio_getlong(XDR*, int32_t*);
+static unsigned int xdrstdio_getlongs(XDR*, int32_t*, unsigned int);
 static int xdrstdio_putlong(XDR*, int32_t*);
 static int xdrstdio_getbytes(XDR*, char*, unsigned int);
 static int xdrstdio_putbytes(XDR*, char*, unsigned int);
+static const char* xdrstdio_inline(XDR*, unsigned int);
 static int64_t xdrstdio_getpos(XDR*);
 static int xdrstdio_setpos(XDR*, int64_t, int);
 static void xdrstdio_destroy(XDR*);
@@ -2017,6 +2446,8 @@ static const struct xdr_ops xdrstdio_ops = {
     xdrstdio_putlong,  /* serialize a long int */
     xdrstdio_getbytes, /* deserialize counted bytes */
     xdrstdio_putbytes, /* serialize counted bytes */
+    xdrstdio_getlongs, /* deserialize an array of long ints */
+    xdrstdio_inline,   /* no zero-copy access */
     xdrstdio_getpos,   /* get offset in the stream */
     xdrstdio_setpos,   /* set offset in the stream */
     xdrstdio_destroy,  /* destroy stream */
@@ -2053,6 +2484,17 @@ static int xdrstdio_getlong(XDR* xdrs, int32_t* lp) {
     return 1;
 }
 
+static unsigned int xdrstdio_getlongs(XDR* xdrs, int32_t* lp, unsigned int len) {
+    /* raw big endian words, byte order is fixed by the caller */
+    return (unsigned int)fread((char*)lp, 4, len, (FILE*)xdrs->x_private);
+}
+
+static const char* xdrstdio_inline(XDR* xdrs, unsigned int len) {
+    (void)xdrs;
+    (void)len;
+    return NULL;
+}
+
 static int xdrstdio_putlong(XDR* xdrs, int32_t* lp) {
     int32_t mycopy = xdr_htonl(*lp);
     lp = &mycopy;
@@ -2103,17 +2545,216 @@ static int xdrstdio_setpos(XDR* xdrs, int64_t pos, int whence) {
 #endif
 }
 
+#ifdef XDRFILE_MMAP
+/*
+ * Read only memory mapped xdr stream. Positioning is pointer arithmetic and
+ * byte reads are memcpy or a view into the mapping. The mapping is reference
+ * counted so that handles created with xdrfile_dup share it, each with its
+ * own position.
+ */
+typedef struct {
+    const char* base;
+    size_t size;
+    int refcount;
+} xdrmapping;
+
+struct xdrmem {
+    xdrmapping* map;
+    size_t pos;
+};
+
+static int xdrmem_getlong(XDR*, int32_t*);
+static int xdrmem_putlong(XDR*, int32_t*);
+static int xdrmem_getbytes(XDR*, char*, unsigned int);
+static int xdrmem_putbytes(XDR*, char*, unsigned int);
+static unsigned int xdrmem_getlongs(XDR*, int32_t*, unsigned int);
+static const char* xdrmem_inline(XDR*, unsigned int);
+static int64_t xdrmem_getpos(XDR*);
+static int xdrmem_setpos(XDR*, int64_t, int);
+static void xdrmem_destroy(XDR*);
+
+/*
+ * Ops vector for memory mapped xdr
+ */
+static const struct xdr_ops xdrmem_ops = {
+    xdrmem_getlong,  /* deserialize a long int */
+    xdrmem_putlong,  /* read only, fails */
+    xdrmem_getbytes, /* deserialize counted bytes */
+    xdrmem_putbytes, /* read only, fails */
+    xdrmem_getlongs, /* deserialize an array of long ints */
+    xdrmem_inline,   /* view into the mapping */
+    xdrmem_getpos,   /* get offset in the stream */
+    xdrmem_setpos,   /* set offset in the stream */
+    xdrmem_destroy,  /* destroy stream */
+};
+
+/* Map the whole file, NULL if it is not a regular non-empty file or mmap fails. */
+static xdrmem* xdrmem_map(int fd) {
+    struct stat st;
+    xdrmapping* map;
+    xdrmem* mem;
+    void* base;
+
+    if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+        return NULL;
+    }
+    base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (base == MAP_FAILED) {
+        return NULL;
+    }
+    madvise(base, (size_t)st.st_size, MADV_SEQUENTIAL);
+    if ((map = (xdrmapping*)malloc(sizeof(xdrmapping))) == NULL) {
+        munmap(base, (size_t)st.st_size);
+        return NULL;
+    }
+    if ((mem = (xdrmem*)malloc(sizeof(xdrmem))) == NULL) {
+        munmap(base, (size_t)st.st_size);
+        free(map);
+        return NULL;
+    }
+    map->base = (const char*)base;
+    map->size = (size_t)st.st_size;
+    map->refcount = 1;
+    mem->map = map;
+    mem->pos = 0;
+    return mem;
+}
+
+/* New stream over the same mapping, positioned at the start. */
+static xdrmem* xdrmem_share(xdrmem* mem) {
+    xdrmem* shared;
+
+    if ((shared = (xdrmem*)malloc(sizeof(xdrmem))) == NULL) {
+        return NULL;
+    }
+    __atomic_add_fetch(&mem->map->refcount, 1, __ATOMIC_RELAXED);
+    shared->map = mem->map;
+    shared->pos = 0;
+    return shared;
+}
+
+static void xdrmem_unmap(xdrmem* mem) {
+    if (__atomic_sub_fetch(&mem->map->refcount, 1, __ATOMIC_ACQ_REL) == 0) {
+        munmap((void*)mem->map->base, mem->map->size);
+        free(mem->map);
+    }
+    free(mem);
+}
+
+static void xdrmem_create(XDR* xdrs, xdrmem* mem) {
+    xdrs->x_op = XDR_DECODE;
+    xdrs->x_ops = &xdrmem_ops;
+    xdrs->x_private = (void*)mem;
+}
+
+static void xdrmem_destroy(XDR* xdrs) { (void)xdrs; }
+
+/* Bytes left after the current position, seeking past the end is allowed. */
+static size_t xdrmem_left(const xdrmem* mem) {
+    return mem->pos < mem->map->size ? mem->map->size - mem->pos : 0;
+}
+
+static int xdrmem_getlong(XDR* xdrs, int32_t* lp) {
+    xdrmem* mem = (xdrmem*)xdrs->x_private;
+    int32_t mycopy;
+
+    if (xdrmem_left(mem) < 4) {
+        return 0;
+    }
+    memcpy(&mycopy, mem->map->base + mem->pos, 4);
+    mem->pos += 4;
+    *lp = (int32_t)xdr_ntohl(mycopy);
+    return 1;
+}
+
+static unsigned int xdrmem_getlongs(XDR* xdrs, int32_t* lp, unsigned int len) {
+    xdrmem* mem = (xdrmem*)xdrs->x_private;
+    size_t left = xdrmem_left(mem) / 4;
+
+    if (len > left) {
+        len = (unsigned int)left;
+    }
+    if (len == 0) {
+        /* The position may be past the end of the mapping after a seek. */
+        return 0;
+    }
+    memcpy(lp, mem->map->base + mem->pos, (size_t)len * 4);
+    mem->pos += (size_t)len * 4;
+    return len;
+}
+
+static int xdrmem_getbytes(XDR* xdrs, char* addr, unsigned int len) {
+    xdrmem* mem = (xdrmem*)xdrs->x_private;
+
+    if (xdrmem_left(mem) < len) {
+        return 0;
+    }
+    if (len == 0) {
+        return 1;
+    }
+    memcpy(addr, mem->map->base + mem->pos, len);
+    mem->pos += len;
+    return 1;
+}
+
+static const char* xdrmem_inline(XDR* xdrs, unsigned int len) {
+    xdrmem* mem = (xdrmem*)xdrs->x_private;
+    const char* addr;
+
+    if (xdrmem_left(mem) < len) {
+        return NULL;
+    }
+    addr = mem->map->base + mem->pos;
+    mem->pos += len;
+    return addr;
+}
+
+static int xdrmem_putlong(XDR* xdrs, int32_t* lp) {
+    (void)xdrs;
+    (void)lp;
+    return 0;
+}
+
+static int xdrmem_putbytes(XDR* xdrs, char* addr, unsigned int len) {
+    (void)xdrs;
+    (void)addr;
+    (void)len;
+    return 0;
+}
+
+static int64_t xdrmem_getpos(XDR* xdrs) { return (int64_t)((xdrmem*)xdrs->x_private)->pos; }
+
+static int xdrmem_setpos(XDR* xdrs, int64_t pos, int whence) {
+    xdrmem* mem = (xdrmem*)xdrs->x_private;
+
+    if (whence == SEEK_CUR) {
+        pos += (int64_t)mem->pos;
+    } else if (whence == SEEK_END) {
+        pos += (int64_t)mem->map->size;
+    } else if (whence != SEEK_SET) {
+        return EINVAL;
+    }
+    if (pos < 0) {
+        return EINVAL;
+    }
+    mem->pos = (size_t)pos;
+    return exdrOK;
+}
+#endif /* XDRFILE_MMAP */
+
 int64_t xdr_tell(XDRFILE* xd)
 /* Reads position in file */
 {
-    return (int64_t)xdrstdio_getpos(xd->xdr);
+    XDR* xdrs = (XDR*)(xd->xdr);
+    return (*xdrs->x_ops->x_getpostn)(xdrs);
 }
 
 int xdr_seek(XDRFILE* xd, int64_t pos, int whence)
 /* Seeks to position in file */
 {
+    XDR* xdrs = (XDR*)(xd->xdr);
     int result;
-    if ((result = xdrstdio_setpos(xd->xdr, (int64_t)pos, whence)) != 0)
+    if ((result = (*xdrs->x_ops->x_setpostn)(xdrs, pos, whence)) != 0)
         return result;
 
     return exdrOK;
@@ -728,6 +728,86 @@ static void test_trr_flag() {
     printf(" PASSED\n");
 }
 
+/* Compare the optimised coordinate decoder with the reference one on synthetic
+ * water-like frames and report the decoding rate of both.
+ */
+static void test_xtc_fast_decompression() {
+    const char* testfn = "test_fast_decompression.xtc";
+    const int natoms_list[] = {10000, 100000, 1000000, 10000000};
+    const float prec = 1000;
+    XDRFILE* xd;
+    int i, j, n, natoms, ncoord, result;
+    float *x, *x_ref, *x_fast, prec_read, box;
+    double t_ref, t_fast;
+    clock_t t0;
+
+    printf("Testing fast xtc coordinate decompression:\n");
+    for (n = 0; n < (int)(sizeof(natoms_list) / sizeof(*natoms_list)); n++) {
+        natoms = natoms_list[n];
+        box = (float)pow(natoms / 100.0, 1.0 / 3.0);
+        x = (float*)malloc(3 * natoms * sizeof(float));
+        x_ref = (float*)malloc(3 * natoms * sizeof(float));
+        x_fast = (float*)malloc(3 * natoms * sizeof(float));
+        if (!x || !x_ref || !x_fast) {
+            die("Allocating memory for coordinates");
+        }
+        srand(1234 + n);
+        for (i = 0; i < natoms; i++) {
+            for (j = 0; j < 3; j++) {
+                if (i % 3 == 0) {
+                    x[3 * i + j] = box * rand() / (float)RAND_MAX;
+                } else {
+                    x[3 * i + j] = x[3 * (i - i % 3) + j] + 0.1f * (rand() / (float)RAND_MAX - 0.5f);
+                }
+            }
+        }
+
+        xd = xdrfile_open(testfn, "w");
+        if (NULL == xd) {
+            die("Opening xdrfile for writing");
+        }
+        if (xdrfile_compress_coord_float(x, natoms, prec, xd) < 0) {
+            die("Compressing coordinates");
+        }
+        xdrfile_close(xd);
+
+        for (j = 0; j < 2; j++) {
+            xdrfile_set_fast_decompression(j);
+            xd = xdrfile_open(testfn, "r");
+            if (NULL == xd) {
+                die("Opening xdrfile for reading");
+            }
+            ncoord = natoms;
+            t0 = clock();
+            result = xdrfile_decompress_coord_float(j ? x_fast : x_ref, &ncoord, &prec_read, xd);
+            if (j) {
+                t_fast = (double)(clock() - t0) / CLOCKS_PER_SEC;
+            } else {
+                t_ref = (double)(clock() - t0) / CLOCKS_PER_SEC;
+            }
+            if (result != natoms) {
+                die_r("Decompressing coordinates", result);
+            }
+            xdrfile_close(xd);
+        }
+        if (memcmp(x_ref, x_fast, 3 * natoms * sizeof(float)) != 0) {
+            die("Fast decompression differs from the reference");
+        }
+        printf("  %8d atoms: reference %.1f Matoms/s, fast %.1f Matoms/s\n", natoms,
+               natoms / t_ref * 1e-6, natoms / t_fast * 1e-6);
+
+        free(x);
+        free(x_ref);
+        free(x_fast);
+    }
+    xdrfile_set_fast_decompression(1);
+
+#ifdef HAVE_UNISTD
+    unlink(testfn);
+#endif
+    printf(" PASSED\n");
+}
+
 int main(int argc, char* argv[]) {
     /* Test basic stuff */
     test_basic();
@@ -736,6 +816,9 @@ int main(int argc, char* argv[]) {
 
     test_trr();
 
+    /* Test the optimised coordinate decoder against the reference, before the tests that need ../test_data */
+    test_xtc_fast_decompression();
+
     /* Test offsets of trr file by comparing to hard coded framesize */
     test_trr_offsets();
 
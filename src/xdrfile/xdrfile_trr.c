@@ -191,12 +191,90 @@ static int do_trnheader(XDRFILE* xd, bool read, t_trnheader* sh) {
     return exdrOK;
 }
 
-static int do_htrn(XDRFILE* xd, bool read, t_trnheader* sh, matrix box, rvec* x, rvec* v, rvec* f) {
+/* Decoding state kept between frames, see trr_context_create. */
+struct trr_context {
+    t_trnheader sh;      /* Header of the last frame                 */
+    void* scratch;       /* Buffer for double or discarded arrays    */
+    size_t scratch_size; /* Allocated bytes in scratch               */
+    uint8_t fields;      /* TRR_HAS_* blocks to decode when reading  */
+};
+
+static void trr_context_init(trr_context* ctx) {
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->fields = TRR_HAS_POSITIONS | TRR_HAS_VELOCITIES | TRR_HAS_FORCES;
+}
+
+/* Grow the scratch buffer of ctx to at least size bytes. */
+static void* trr_scratch(trr_context* ctx, size_t size) {
+    void* scratch;
+
+    if (size > ctx->scratch_size) {
+        if ((scratch = realloc(ctx->scratch, size)) == NULL) {
+            return NULL;
+        }
+        ctx->scratch = scratch;
+        ctx->scratch_size = size;
+    }
+    return ctx->scratch;
+}
+
+/* Read or write one natoms x DIM block (x, v or f) of size bytes. Single
+ * precision data goes straight between the file and the rvec array, double
+ * precision data and arrays the caller does not want (NULL) go through the
+ * scratch buffer. When reading a block outside the fields of ctx it is
+ * skipped with a seek. */
+static int do_htrn_rvec(XDRFILE* xd, bool read, t_trnheader* sh, trr_context* ctx, uint8_t field,
+                        int size, rvec* x) {
+    int i, n = sh->natoms * DIM;
+    float* px = (NULL != x) ? x[0] : NULL;
+    float* fx;
+    double* dx;
+    int last;
+
+    if (read && !(ctx->fields & field)) {
+        /* A seek past the end of the file succeeds, reading the last word of the
+         * block rejects a truncated frame as decoding it would. */
+        if (xdr_seek(xd, (int64_t)size - 4, SEEK_CUR) != exdrOK || xdrfile_read_int(&last, 1, xd) != 1) {
+            return sh->use_double ? exdrDOUBLE : exdrFLOAT;
+        }
+        return exdrOK;
+    }
+
+    if (!sh->use_double) {
+        fx = (NULL != px) ? px : (float*)trr_scratch(ctx, n * sizeof(float));
+        if (NULL == fx) {
+            return exdrNOMEM;
+        }
+        if ((read ? xdrfile_read_float(fx, n, xd) : xdrfile_write_float(fx, n, xd)) != n) {
+            return exdrFLOAT;
+        }
+        return exdrOK;
+    }
+
+    if (NULL == (dx = (double*)trr_scratch(ctx, n * sizeof(double)))) {
+        return exdrNOMEM;
+    }
+    if (!read && NULL != px) {
+        for (i = 0; i < n; i++) {
+            dx[i] = (double)px[i];
+        }
+    }
+    if ((read ? xdrfile_read_double(dx, n, xd) : xdrfile_write_double(dx, n, xd)) != n) {
+        return exdrDOUBLE;
+    }
+    if (read && NULL != px) {
+        for (i = 0; i < n; i++) {
+            px[i] = (float)dx[i];
+        }
+    }
+    return exdrOK;
+}
+
+static int do_htrn(XDRFILE* xd, bool read, t_trnheader* sh, trr_context* ctx, matrix box, rvec* x,
+                   rvec* v, rvec* f) {
     double pvd[DIM * DIM];
-    double* dx = NULL;
     float pvf[DIM * DIM];
-    float* fx = NULL;
-    int i, j;
+    int i, j, result;
 
     if (sh->use_double) {
         if (sh->box_size != 0) {
@@ -233,84 +311,6 @@ static int do_htrn(XDRFILE* xd, bool read, t_trnheader* sh, matrix box, rvec* x,
                 return exdrDOUBLE;
             }
         }
-
-        if ((sh->x_size != 0) || (sh->v_size != 0) || (sh->f_size != 0)) {
-            dx = (double*)calloc(sh->natoms * DIM, sizeof(dx[0]));
-            if (NULL == dx) {
-                return exdrNOMEM;
-            }
-        }
-        if (sh->x_size != 0) {
-            if (!read) {
-                if (NULL != x) {
-                    for (i = 0; (i < sh->natoms); i++) {
-                        for (j = 0; (j < DIM); j++) {
-                            dx[i * DIM + j] = (double)x[i][j];
-                        }
-                    }
-                }
-            }
-            if (xdrfile_read_double(dx, sh->natoms * DIM, xd) == sh->natoms * DIM) {
-                if (read) {
-                    if (NULL != x) {
-                        for (i = 0; (i < sh->natoms); i++) {
-                            for (j = 0; (j < DIM); j++) {
-                                x[i][j] = (float)dx[i * DIM + j];
-                            }
-                        }
-                    }
-                }
-            } else {
-                return exdrDOUBLE;
-            }
-        }
-        if (sh->v_size != 0) {
-            if (!read) {
-                if (NULL != v) {
-                    for (i = 0; (i < sh->natoms); i++) {
-                        for (j = 0; (j < DIM); j++) {
-                            dx[i * DIM + j] = (double)v[i][j];
-                        }
-                    }
-                }
-            }
-            if (xdrfile_read_double(dx, sh->natoms * DIM, xd) == sh->natoms * DIM) {
-                if (NULL != v) {
-                    for (i = 0; (i < sh->natoms); i++) {
-                        for (j = 0; (j < DIM); j++) {
-                            v[i][j] = (float)dx[i * DIM + j];
-                        }
-                    }
-                }
-            } else {
-                return exdrDOUBLE;
-            }
-        }
-        if (sh->f_size != 0) {
-            if (!read) {
-                if (NULL != f) {
-                    for (i = 0; (i < sh->natoms); i++) {
-                        for (j = 0; (j < DIM); j++) {
-                            dx[i * DIM + j] = (double)f[i][j];
-                        }
-                    }
-                }
-            }
-            if (xdrfile_read_double(dx, sh->natoms * DIM, xd) == sh->natoms * DIM) {
-                if (NULL != f) {
-                    for (i = 0; (i < sh->natoms); i++) {
-                        for (j = 0; (j < DIM); j++) {
-                            f[i][j] = (float)dx[i * DIM + j];
-                        }
-                    }
-                }
-            } else {
-                return exdrDOUBLE;
-            }
-        }
-        if ((sh->x_size != 0) || (sh->v_size != 0) || (sh->f_size != 0)) {
-            free(dx);
-        }
     } else
     /* Float */
     {
@@ -348,94 +348,29 @@ static int do_htrn(XDRFILE* xd, bool read, t_trnheader* sh, matrix box, rvec* x,
                 return exdrFLOAT;
             }
         }
+    }
 
-        if ((sh->x_size != 0) || (sh->v_size != 0) || (sh->f_size != 0)) {
-            fx = (float*)calloc(sh->natoms * DIM, sizeof(fx[0]));
-            if (NULL == fx) {
-                return exdrNOMEM;
-            }
-        }
-        if (sh->x_size != 0) {
-            if (!read) {
-                if (NULL != x) {
-                    for (i = 0; (i < sh->natoms); i++) {
-                        for (j = 0; (j < DIM); j++) {
-                            fx[i * DIM + j] = x[i][j];
-                        }
-                    }
-                }
-            }
-            if (xdrfile_read_float(fx, sh->natoms * DIM, xd) == sh->natoms * DIM) {
-                if (read) {
-                    if (NULL != x) {
-                        for (i = 0; (i < sh->natoms); i++) {
-                            for (j = 0; (j < DIM); j++) {
-                                x[i][j] = fx[i * DIM + j];
-                            }
-                        }
-                    }
-                }
-            } else {
-                return exdrFLOAT;
-            }
-        }
-        if (sh->v_size != 0) {
-            if (!read) {
-                if (NULL != v) {
-                    for (i = 0; (i < sh->natoms); i++) {
-                        for (j = 0; (j < DIM); j++) {
-                            fx[i * DIM + j] = v[i][j];
-                        }
-                    }
-                }
-            }
-            if (xdrfile_read_float(fx, sh->natoms * DIM, xd) == sh->natoms * DIM) {
-                if (NULL != v) {
-                    for (i = 0; (i < sh->natoms); i++) {
-                        for (j = 0; (j < DIM); j++) {
-                            v[i][j] = fx[i * DIM + j];
-                        }
-                    }
-                }
-            } else {
-                return exdrFLOAT;
-            }
-        }
-        if (sh->f_size != 0) {
-            if (!read) {
-                if (NULL != f) {
-                    for (i = 0; (i < sh->natoms); i++) {
-                        for (j = 0; (j < DIM); j++) {
-                            fx[i * DIM + j] = f[i][j];
-                        }
-                    }
-                }
-            }
-            if (xdrfile_read_float(fx, sh->natoms * DIM, xd) == sh->natoms * DIM) {
-                if (NULL != f) {
-                    for (i = 0; (i < sh->natoms); i++) {
-                        for (j = 0; (j < DIM); j++) {
-                            f[i][j] = fx[i * DIM + j];
-                        }
-                    }
-                }
-            } else {
-                return exdrFLOAT;
-            }
-        }
-        if ((sh->x_size != 0) || (sh->v_size != 0) || (sh->f_size != 0)) {
-            free(fx);
-        }
+    if (sh->x_size != 0 &&
+        (result = do_htrn_rvec(xd, read, sh, ctx, TRR_HAS_POSITIONS, sh->x_size, x)) != exdrOK) {
+        return result;
+    }
+    if (sh->v_size != 0 &&
+        (result = do_htrn_rvec(xd, read, sh, ctx, TRR_HAS_VELOCITIES, sh->v_size, v)) != exdrOK) {
+        return result;
+    }
+    if (sh->f_size != 0 &&
+        (result = do_htrn_rvec(xd, read, sh, ctx, TRR_HAS_FORCES, sh->f_size, f)) != exdrOK) {
+        return result;
     }
     return exdrOK;
 }
 
-static int do_trn(XDRFILE* xd, bool read, int* step, float* t, float* lambda, matrix box,
-                  int* natoms, rvec* x, rvec* v, rvec* f, uint8_t* has_prop) {
-    t_trnheader* sh;
+static int do_trn(XDRFILE* xd, bool read, trr_context* ctx, int* step, float* t, float* lambda,
+                  matrix box, int* natoms, rvec* x, rvec* v, rvec* f, uint8_t* has_prop) {
+    t_trnheader* sh = &ctx->sh;
     int result;
 
-    sh = (t_trnheader*)calloc(1, sizeof(*sh));
+    memset(sh, 0, sizeof(*sh));
 
     if (!read) {
         sh->box_size = (NULL != box) ? sizeof(matrix) : 0;
@@ -473,13 +408,7 @@ static int do_trn(XDRFILE* xd, bool read, int* step, float* t, float* lambda, ma
             *has_prop |= TRR_HAS_FORCES;
         }
     }
-    if ((result = do_htrn(xd, read, sh, box, x, v, f)) != exdrOK) {
-        return result;
-    }
-
-    free(sh);
-
-    return exdrOK;
+    return do_htrn(xd, read, sh, ctx, box, x, v, f);
 }
 
 /************************************************************
@@ -595,12 +524,44 @@ int read_trr_header(const char* fn, int* natoms, unsigned long* nframes, int64_t
     return exdrOK;
 }
 
+trr_context* trr_context_create(void) {
+    trr_context* ctx = (trr_context*)malloc(sizeof(trr_context));
+    if (ctx) {
+        trr_context_init(ctx);
+    }
+    return ctx;
+}
+
+void trr_context_set_fields(trr_context* ctx, uint8_t fields) { ctx->fields = fields; }
+
+void trr_context_free(trr_context* ctx) {
+    if (ctx) {
+        free(ctx->scratch);
+        free(ctx);
+    }
+}
+
 int write_trr(XDRFILE* xd, int natoms, int step, float t, float lambda, matrix box, rvec* x,
               rvec* v, rvec* f) {
-    return do_trn(xd, false, &step, &t, &lambda, box, &natoms, x, v, f, NULL);
+    trr_context ctx;
+    int result;
+    trr_context_init(&ctx);
+    result = do_trn(xd, false, &ctx, &step, &t, &lambda, box, &natoms, x, v, f, NULL);
+    free(ctx.scratch);
+    return result;
 }
 
 int read_trr(XDRFILE* xd, int natoms, int* step, float* t, float* lambda, matrix box, rvec* x,
              rvec* v, rvec* f, uint8_t* has_prop) {
-    return do_trn(xd, true, step, t, lambda, box, &natoms, x, v, f, has_prop);
+    trr_context ctx;
+    int result;
+    trr_context_init(&ctx);
+    result = do_trn(xd, true, &ctx, step, t, lambda, box, &natoms, x, v, f, has_prop);
+    free(ctx.scratch);
+    return result;
+}
+
+int read_trr_context(trr_context* ctx, XDRFILE* xd, int natoms, int* step, float* t, float* lambda,
+                     matrix box, rvec* x, rvec* v, rvec* f, uint8_t* has_prop) {
+    return do_trn(xd, true, ctx, step, t, lambda, box, &natoms, x, v, f, has_prop);
 }